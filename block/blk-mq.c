@@ -348,6 +348,7 @@ static void blk_mq_start_request(struct request *rq, bool last)
 {
 	struct request_queue *q = rq->q;
 
+	set_io_start_time_ns(rq);
 	trace_block_rq_issue(q, rq);
 
 	/*
@@ -29,9 +29,16 @@
 /*
  * Each block ramdisk device has a radix_tree brd_pages of pages that stores
  * the pages containing the block device's contents. A brd page's ->index is
- * its offset in PAGE_SIZE units. This is similar to, but in no way connected
- * with, the kernel's pagecache or buffer cache (which sit above our block
- * device).
+ * its offset in PAGE_SIZE << brd_order units. This is similar to, but in no
+ * way connected with, the kernel's pagecache or buffer cache (which sit above
+ * our block device).
+ *
+ * With brd_order > 0 the backing store is made of physically contiguous
+ * compound pages, so a 2MB chunk costs one radix-tree slot instead of 512 and
+ * ->direct_access users get memory that is contiguous across page boundaries.
+ * When such a chunk cannot be allocated, that chunk is backed by order-0
+ * pages kept in brd_small_pages, indexed in PAGE_SIZE units, instead.
+ * brd_lock makes sure any one chunk is backed one way or the other.
  */
 struct brd_device {
 	int		brd_number;
@@ -46,8 +53,15 @@ struct brd_device {
 	 */
 	spinlock_t		brd_lock;
 	struct radix_tree_root	brd_pages;
+	struct radix_tree_root	brd_small_pages;
+	unsigned int		brd_order;
 };
 
+static inline unsigned int brd_chunk_sectors_shift(struct brd_device *brd)
+{
+	return PAGE_SECTORS_SHIFT + brd->brd_order;
+}
+
 /*
  * Look up and return a brd's page for a given sector.
  */
@@ -56,6 +70,7 @@ static struct page *brd_lookup_page(struct brd_device *brd, sector_t sector)
 {
 	pgoff_t idx;
 	struct page *page;
+	unsigned int sub;
 
 	/*
 	 * The page lifetime is protected by the fact that we have opened the
@@ -69,13 +84,41 @@ static struct page *brd_lookup_page(struct brd_device *brd, sector_t sector)
 	 * here, only deletes).
 	 */
 	rcu_read_lock();
-	idx = sector >> PAGE_SECTORS_SHIFT; /* sector to page index */
+	idx = sector >> brd_chunk_sectors_shift(brd); /* sector to chunk index */
 	page = radix_tree_lookup(&brd->brd_pages, idx);
+	if (!page && brd->brd_order) {
+		/* The chunk may have fallen back to order-0 pages */
+		idx = sector >> PAGE_SECTORS_SHIFT;
+		page = radix_tree_lookup(&brd->brd_small_pages, idx);
+		rcu_read_unlock();
+		BUG_ON(page && page->index != idx);
+		return page;
+	}
 	rcu_read_unlock();
 
-	BUG_ON(page && page->index != idx);
+	if (!page)
+		return NULL;
+
+	BUG_ON(page->index != idx);
 
-	return page;
+	/* Return the PAGE_SIZE subpage of the chunk that holds sector. */
+	sub = (sector >> PAGE_SECTORS_SHIFT) & ((1U << brd->brd_order) - 1);
+	return page + sub;
+}
+
+/*
+ * Has part of chunk @idx already been backed by order-0 pages?
+ * Called with brd_lock held.
+ */
+static bool brd_chunk_is_small(struct brd_device *brd, pgoff_t idx)
+{
+	pgoff_t first = idx << brd->brd_order;
+	struct page *page;
+
+	if (!radix_tree_gang_lookup(&brd->brd_small_pages, (void **)&page,
+				    first, 1))
+		return false;
+	return page->index < first + (1UL << brd->brd_order);
 }
 
 /*
@@ -85,6 +128,8 @@ static struct page *brd_lookup_page(struct brd_device *brd, sector_t sector)
  */
 static struct page *brd_insert_page(struct brd_device *brd, sector_t sector)
 {
+	struct radix_tree_root *root;
+	unsigned int order = brd->brd_order;
 	pgoff_t idx;
 	struct page *page;
 	gfp_t gfp_flags;
@@ -106,21 +151,55 @@ static struct page *brd_insert_page(struct brd_device *brd, sector_t sector)
 #ifndef CONFIG_BLK_DEV_XIP
 	gfp_flags |= __GFP_HIGHMEM;
 #endif
-	page = alloc_page(gfp_flags);
+retry:
+	/*
+	 * Compound, so that ->direct_access mappings of tail pages pin the
+	 * whole chunk rather than a refcount-less tail.  Chunks are only an
+	 * optimisation: if one can't be had easily under GFP_NOIO, back this
+	 * part of the disk with order-0 pages rather than fail the write.
+	 */
+	page = NULL;
+	if (order)
+		page = alloc_pages(gfp_flags | __GFP_COMP | __GFP_NORETRY |
+				   __GFP_NOWARN, order);
+	if (!page) {
+		order = 0;
+		page = alloc_page(gfp_flags);
+	}
 	if (!page)
 		return NULL;
 
 	if (radix_tree_preload(GFP_NOIO)) {
-		__free_page(page);
+		__free_pages(page, order);
 		return NULL;
 	}
 
 	spin_lock(&brd->brd_lock);
-	idx = sector >> PAGE_SECTORS_SHIFT;
+	idx = sector >> brd_chunk_sectors_shift(brd);
+	root = &brd->brd_pages;
+	if (order && brd_chunk_is_small(brd, idx)) {
+		/* Too late, we lost the race with a fallback */
+		spin_unlock(&brd->brd_lock);
+		radix_tree_preload_end();
+		__free_pages(page, order);
+		order = 0;
+		goto retry;
+	}
+	if (!order && brd->brd_order) {
+		if (radix_tree_lookup(&brd->brd_pages, idx)) {
+			/* Somebody else got the whole chunk meanwhile */
+			spin_unlock(&brd->brd_lock);
+			radix_tree_preload_end();
+			__free_page(page);
+			return brd_lookup_page(brd, sector);
+		}
+		root = &brd->brd_small_pages;
+		idx = sector >> PAGE_SECTORS_SHIFT;
+	}
 	page->index = idx;
-	if (radix_tree_insert(&brd->brd_pages, idx, page)) {
-		__free_page(page);
-		page = radix_tree_lookup(&brd->brd_pages, idx);
+	if (radix_tree_insert(root, idx, page)) {
+		__free_pages(page, order);
+		page = radix_tree_lookup(root, idx);
 		BUG_ON(!page);
 		BUG_ON(page->index != idx);
 	}
@@ -128,7 +207,7 @@ static struct page *brd_insert_page(struct brd_device *brd, sector_t sector)
 
 	radix_tree_preload_end();
 
-	return page;
+	return brd_lookup_page(brd, sector);
 }
 
 static void brd_free_page(struct brd_device *brd, sector_t sector)
@@ -137,8 +216,16 @@ static void brd_free_page(struct brd_device *brd, sector_t sector)
 	pgoff_t idx;
 
 	spin_lock(&brd->brd_lock);
-	idx = sector >> PAGE_SECTORS_SHIFT;
+	idx = sector >> brd_chunk_sectors_shift(brd);
 	page = radix_tree_delete(&brd->brd_pages, idx);
+	if (page) {
+		spin_unlock(&brd->brd_lock);
+		__free_pages(page, brd->brd_order);
+		return;
+	}
+	if (brd->brd_order)
+		page = radix_tree_delete(&brd->brd_small_pages,
+					 sector >> PAGE_SECTORS_SHIFT);
 	spin_unlock(&brd->brd_lock);
 	if (page)
 		__free_page(page);
@@ -158,7 +245,7 @@ static void brd_zero_page(struct brd_device *brd, sector_t sector)
  * there are no other users of the device.
  */
 #define FREE_BATCH 16
-static void brd_free_pages(struct brd_device *brd)
+static void brd_free_tree(struct radix_tree_root *root, unsigned int order)
 {
 	unsigned long pos = 0;
 	struct page *pages[FREE_BATCH];
@@ -167,7 +254,7 @@ static void brd_free_pages(struct brd_device *brd)
 	do {
 		int i;
 
-		nr_pages = radix_tree_gang_lookup(&brd->brd_pages,
+		nr_pages = radix_tree_gang_lookup(root,
 				(void **)pages, pos, FREE_BATCH);
 
 		for (i = 0; i < nr_pages; i++) {
@@ -175,9 +262,9 @@ static void brd_free_pages(struct brd_device *brd)
 
 			BUG_ON(pages[i]->index < pos);
 			pos = pages[i]->index;
-			ret = radix_tree_delete(&brd->brd_pages, pos);
+			ret = radix_tree_delete(root, pos);
 			BUG_ON(!ret || ret != pages[i]);
-			__free_page(pages[i]);
+			__free_pages(pages[i], order);
 		}
 
 		pos++;
@@ -190,6 +277,12 @@ static void brd_free_pages(struct brd_device *brd)
 	} while (nr_pages == FREE_BATCH);
 }
 
+static void brd_free_pages(struct brd_device *brd)
+{
+	brd_free_tree(&brd->brd_pages, brd->brd_order);
+	brd_free_tree(&brd->brd_small_pages, 0);
+}
+
 /*
  * copy_to_brd_setup must be called before copy_to_brd. It may sleep.
  */
@@ -432,12 +525,15 @@ static int rd_nr;
 int rd_size = CONFIG_BLK_DEV_RAM_SIZE;
 static int max_part;
 static int part_shift;
+static unsigned int rd_page_order;
 module_param(rd_nr, int, S_IRUGO);
 MODULE_PARM_DESC(rd_nr, "Maximum number of brd devices");
 module_param(rd_size, int, S_IRUGO);
 MODULE_PARM_DESC(rd_size, "Size of each RAM disk in kbytes.");
 module_param(max_part, int, S_IRUGO);
 MODULE_PARM_DESC(max_part, "Maximum number of partitions per RAM disk");
+module_param(rd_page_order, uint, S_IRUGO);
+MODULE_PARM_DESC(rd_page_order, "Allocation order of RAM disk backing chunks (9 gives 2MB chunks with 4K pages)");
 MODULE_LICENSE("GPL");
 MODULE_ALIAS_BLOCKDEV_MAJOR(RAMDISK_MAJOR);
 MODULE_ALIAS("rd");
@@ -468,8 +564,10 @@ static struct brd_device *brd_alloc(int i)
 	if (!brd)
 		goto out;
 	brd->brd_number		= i;
+	brd->brd_order		= rd_page_order;
 	spin_lock_init(&brd->brd_lock);
 	INIT_RADIX_TREE(&brd->brd_pages, GFP_ATOMIC);
+	INIT_RADIX_TREE(&brd->brd_small_pages, GFP_ATOMIC);
 
 	brd->brd_queue = blk_alloc_queue(GFP_KERNEL);
 	if (!brd->brd_queue)
@@ -591,6 +689,9 @@ static int __init brd_init(void)
 	if ((1UL << part_shift) > DISK_MAX_PARTS)
 		return -EINVAL;
 
+	if (rd_page_order >= MAX_ORDER)
+		return -EINVAL;
+
 	if (rd_nr > 1UL << (MINORBITS - part_shift))
 		return -EINVAL;
 
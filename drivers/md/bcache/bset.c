@@ -13,6 +13,7 @@
 #include <linux/console.h>
 #include <linux/random.h>
 #include <linux/prefetch.h>
+#include <linux/sched.h>
 
 #ifdef CONFIG_BCACHE_DEBUG
 
@@ -876,6 +877,13 @@ static struct bset_search_iter bset_search_write_set(struct bset_tree *t,
 	while (li + 1 != ri) {
 		unsigned m = (li + ri) >> 1;
 
+		/*
+		 * Whichever way we go, the next probe is one of these two -
+		 * start pulling both in while we compare against this one:
+		 */
+		prefetch(table_to_bkey(t, (li + m) >> 1));
+		prefetch(table_to_bkey(t, (m + ri) >> 1));
+
 		if (bkey_cmp(table_to_bkey(t, m), search) > 0)
 			ri = m;
 		else
@@ -1051,6 +1059,19 @@ static struct bkey *__bch_btree_iter_init(struct btree_keys *b,
 	iter->b = b;
 #endif
 
+	/*
+	 * The searches below are independent - get the top of every set's
+	 * auxiliary search tree in flight up front, instead of taking one
+	 * cache miss per set in series:
+	 */
+	if (search) {
+		struct bset_tree *t;
+
+		for (t = start; t <= bset_tree_last(b); t++)
+			if (t->size)
+				prefetch(&t->tree[1]);
+	}
+
 	for (; start <= bset_tree_last(b); start++) {
 		ret = bch_bset_search(b, start, search);
 		bch_btree_iter_push(iter, ret, bset_bkey_last(start->data));
@@ -1329,3 +1350,33 @@ void bch_btree_keys_stats(struct btree_keys *b, struct bset_stats *stats)
 		}
 	}
 }
+
+#ifdef CONFIG_BCACHE_DEBUG
+/*
+ * Microbenchmark for the lookup path: look up every key in the node, through
+ * bch_btree_iter_init() so that all the sets are searched as a real lookup
+ * would.
+ */
+void bch_btree_keys_search_bench(struct btree_keys *b,
+				 struct bset_search_stats *stats)
+{
+	struct btree_iter iter;
+	struct bset_tree *t;
+	struct bkey *k;
+	uint64_t start;
+
+	for (t = b->set; t <= bset_tree_last(b); t++) {
+		start = local_clock();
+
+		for (k = t->data->start;
+		     k < bset_bkey_last(t->data);
+		     k = bkey_next(k)) {
+			bch_btree_iter_init(b, &iter, k);
+			stats->searches++;
+		}
+
+		stats->ns += local_clock() - start;
+	}
+}
+EXPORT_SYMBOL(bch_btree_keys_search_bench);
+#endif
@@ -378,6 +378,16 @@ struct bset_stats {
 
 void bch_btree_keys_stats(struct btree_keys *, struct bset_stats *);
 
+struct bset_search_stats {
+	size_t searches;
+	uint64_t ns;
+};
+
+#ifdef CONFIG_BCACHE_DEBUG
+void bch_btree_keys_search_bench(struct btree_keys *,
+				 struct bset_search_stats *);
+#endif
+
 /* Bkey utility code */
 
 #define bset_bkey_last(i)	bkey_idx((struct bkey *) (i)->d, (i)->keys)
@@ -60,6 +60,9 @@ read_attribute(btree_used_percent);
 read_attribute(average_key_size);
 read_attribute(dirty_data);
 read_attribute(bset_tree_stats);
+#ifdef CONFIG_BCACHE_DEBUG
+read_attribute(bset_search_bench);
+#endif
 
 read_attribute(state);
 read_attribute(cache_read_races);
@@ -441,6 +444,47 @@ static int bch_bset_print_stats(struct cache_set *c, char *buf)
 			op.stats.floats, op.stats.failed);
 }
 
+#ifdef CONFIG_BCACHE_DEBUG
+struct bset_search_bench_op {
+	struct btree_op op;
+	size_t nodes;
+	struct bset_search_stats stats;
+};
+
+static int bch_btree_bset_search_bench(struct btree_op *b_op, struct btree *b)
+{
+	struct bset_search_bench_op *op =
+		container_of(b_op, struct bset_search_bench_op, op);
+
+	op->nodes++;
+	bch_btree_keys_search_bench(&b->keys, &op->stats);
+
+	return MAP_CONTINUE;
+}
+
+static int bch_bset_print_search_bench(struct cache_set *c, char *buf)
+{
+	struct bset_search_bench_op op;
+	int ret;
+
+	memset(&op, 0, sizeof(op));
+	bch_btree_op_init(&op.op, -1);
+
+	ret = bch_btree_map_nodes(&op.op, c, &ZERO_KEY,
+				  bch_btree_bset_search_bench);
+	if (ret < 0)
+		return ret;
+
+	return snprintf(buf, PAGE_SIZE,
+			"btree nodes:		%zu\n"
+			"searches:		%zu\n"
+			"ns per search:		%llu\n",
+			op.nodes, op.stats.searches,
+			op.stats.searches
+			? div64_u64(op.stats.ns, op.stats.searches) : 0);
+}
+#endif
+
 static unsigned bch_root_usage(struct cache_set *c)
 {
 	unsigned bytes = 0;
@@ -573,6 +617,11 @@ SHOW(__bch_cache_set)
 	if (attr == &sysfs_bset_tree_stats)
 		return bch_bset_print_stats(c, buf);
 
+#ifdef CONFIG_BCACHE_DEBUG
+	if (attr == &sysfs_bset_search_bench)
+		return bch_bset_print_search_bench(c, buf);
+#endif
+
 	return 0;
 }
 SHOW_LOCKED(bch_cache_set)
@@ -723,6 +772,7 @@ static struct attribute *bch_cache_set_internal_files[] = {
 	&sysfs_verify,
 	&sysfs_key_merging_disabled,
 	&sysfs_expensive_debug_checks,
+	&sysfs_bset_search_bench,
 #endif
 	&sysfs_gc_always_rewrite,
 	&sysfs_btree_shrinker_disabled,
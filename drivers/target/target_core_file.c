@@ -31,12 +31,14 @@
 #include <linux/spinlock.h>
 #include <linux/module.h>
 #include <linux/falloc.h>
+#include <linux/workqueue.h>
 #include <scsi/scsi.h>
 #include <scsi/scsi_host.h>
 #include <asm/unaligned.h>
 
 #include <target/target_core_base.h>
 #include <target/target_core_backend.h>
+#include <target/target_core_fabric.h>
 
 #include "target_core_file.h"
 
@@ -230,6 +232,24 @@ static int fd_configure_device(struct se_device *dev)
 	}
 
 	fd_dev->fd_dev_id = fd_host->fd_host_dev_id_count++;
+
+	if (fd_dev->fbd_flags & FDBD_HAS_ASYNC_IO) {
+		/*
+		 * Allow up to hw_queue_depth READ/WRITEs to be in flight
+		 * against the backing file at once, instead of being limited
+		 * by the number of fabric threads calling ->execute_rw().
+		 */
+		fd_dev->fd_wq = alloc_workqueue("fd_io-%u-%u",
+				WQ_MEM_RECLAIM | WQ_UNBOUND,
+				dev->dev_attrib.hw_queue_depth,
+				dev->se_hba->hba_id, fd_dev->fd_dev_id);
+		if (!fd_dev->fd_wq) {
+			pr_err("FILEIO: Unable to allocate fd_io workqueue\n");
+			ret = -ENOMEM;
+			goto fail;
+		}
+	}
+
 	fd_dev->fd_queue_depth = dev->queue_depth;
 
 	pr_debug("CORE_FILE[%u] - Added TCM FILEIO Device ID: %u at %s,"
@@ -249,6 +269,11 @@ static void fd_free_device(struct se_device *dev)
 {
 	struct fd_dev *fd_dev = FD_DEV(dev);
 
+	if (fd_dev->fd_wq) {
+		destroy_workqueue(fd_dev->fd_wq);
+		fd_dev->fd_wq = NULL;
+	}
+
 	if (fd_dev->fd_file) {
 		filp_close(fd_dev->fd_file, NULL);
 		fd_dev->fd_file = NULL;
@@ -613,8 +638,8 @@ fd_execute_unmap(struct se_cmd *cmd)
 }
 
 static sense_reason_t
-fd_execute_rw(struct se_cmd *cmd, struct scatterlist *sgl, u32 sgl_nents,
-	      enum dma_data_direction data_direction)
+__fd_execute_rw(struct se_cmd *cmd, struct scatterlist *sgl, u32 sgl_nents,
+		enum dma_data_direction data_direction)
 {
 	struct se_device *dev = cmd->se_dev;
 	struct fd_prot fd_prot;
@@ -683,6 +708,20 @@ fd_execute_rw(struct se_cmd *cmd, struct scatterlist *sgl, u32 sgl_nents,
 			loff_t end = start + cmd->data_length;
 
 			vfs_fsync_range(fd_dev->fd_file, start, end, 1);
+		} else if (ret > 0 &&
+			   (FD_DEV(dev)->fbd_flags & FDBD_HAS_WRITE_BEHIND)) {
+			struct fd_dev *fd_dev = FD_DEV(dev);
+			loff_t start = cmd->t_task_lba *
+				dev->dev_attrib.block_size;
+			loff_t end = start + cmd->data_length - 1;
+
+			/*
+			 * Start writeback of the range just dirtied without
+			 * waiting for it, as sync_file_range(WRITE) would,
+			 * so that SYNCHRONIZE_CACHE finds little left to do.
+			 */
+			filemap_fdatawrite_range(fd_dev->fd_file->f_mapping,
+						 start, end);
 		}
 
 		if (ret > 0 && cmd->prot_type) {
@@ -703,14 +742,65 @@ fd_execute_rw(struct se_cmd *cmd, struct scatterlist *sgl, u32 sgl_nents,
 	return 0;
 }
 
+static void fd_async_rw_work(struct work_struct *work)
+{
+	struct fd_async_req *req = container_of(work, struct fd_async_req,
+						work);
+	struct se_cmd *cmd = req->cmd;
+	sense_reason_t rc;
+
+	rc = __fd_execute_rw(cmd, req->sgl, req->sgl_nents,
+			     req->data_direction);
+	kfree(req);
+
+	/*
+	 * Mirror __target_execute_cmd() failure handling, as ->execute_rw()
+	 * has already returned to the caller that would normally do this.
+	 */
+	if (rc) {
+		spin_lock_irq(&cmd->t_state_lock);
+		cmd->transport_state &= ~(CMD_T_BUSY|CMD_T_SENT);
+		spin_unlock_irq(&cmd->t_state_lock);
+
+		transport_generic_request_failure(cmd, rc);
+	}
+}
+
+static sense_reason_t
+fd_execute_rw(struct se_cmd *cmd, struct scatterlist *sgl, u32 sgl_nents,
+	      enum dma_data_direction data_direction)
+{
+	struct fd_dev *fd_dev = FD_DEV(cmd->se_dev);
+	struct fd_async_req *req;
+
+	if (!fd_dev->fd_wq)
+		return __fd_execute_rw(cmd, sgl, sgl_nents, data_direction);
+
+	req = kmalloc(sizeof(*req), GFP_KERNEL);
+	if (!req)
+		return __fd_execute_rw(cmd, sgl, sgl_nents, data_direction);
+
+	INIT_WORK(&req->work, fd_async_rw_work);
+	req->cmd = cmd;
+	req->sgl = sgl;
+	req->sgl_nents = sgl_nents;
+	req->data_direction = data_direction;
+
+	queue_work(fd_dev->fd_wq, &req->work);
+	return 0;
+}
+
 enum {
-	Opt_fd_dev_name, Opt_fd_dev_size, Opt_fd_buffered_io, Opt_err
+	Opt_fd_dev_name, Opt_fd_dev_size, Opt_fd_buffered_io,
+	Opt_fd_async_io, Opt_fd_write_behind, Opt_err
 };
 
 static match_table_t tokens = {
 	{Opt_fd_dev_name, "fd_dev_name=%s"},
 	{Opt_fd_dev_size, "fd_dev_size=%s"},
 	{Opt_fd_buffered_io, "fd_buffered_io=%d"},
+	{Opt_fd_async_io, "fd_async_io=%d"},
+	{Opt_fd_write_behind, "fd_write_behind=%d"},
 	{Opt_err, NULL}
 };
 
@@ -774,6 +864,32 @@ static ssize_t fd_set_configfs_dev_params(struct se_device *dev,
 
 			fd_dev->fbd_flags |= FDBD_HAS_BUFFERED_IO_WCE;
 			break;
+		case Opt_fd_async_io:
+			match_int(args, &arg);
+			if (arg != 1) {
+				pr_err("bogus fd_async_io=%d value\n", arg);
+				ret = -EINVAL;
+				goto out;
+			}
+
+			pr_debug("FILEIO: Using asynchronous READ/WRITE"
+				" submission for struct fd_dev\n");
+
+			fd_dev->fbd_flags |= FDBD_HAS_ASYNC_IO;
+			break;
+		case Opt_fd_write_behind:
+			match_int(args, &arg);
+			if (arg != 1) {
+				pr_err("bogus fd_write_behind=%d value\n", arg);
+				ret = -EINVAL;
+				goto out;
+			}
+
+			pr_debug("FILEIO: Using write-behind for buffered"
+				" WRITEs to struct fd_dev\n");
+
+			fd_dev->fbd_flags |= FDBD_HAS_WRITE_BEHIND;
+			break;
 		default:
 			break;
 		}
@@ -790,10 +906,13 @@ static ssize_t fd_show_configfs_dev_params(struct se_device *dev, char *b)
 	ssize_t bl = 0;
 
 	bl = sprintf(b + bl, "TCM FILEIO ID: %u", fd_dev->fd_dev_id);
-	bl += sprintf(b + bl, "        File: %s  Size: %llu  Mode: %s\n",
+	bl += sprintf(b + bl, "        File: %s  Size: %llu  Mode: %s%s%s\n",
 		fd_dev->fd_dev_name, fd_dev->fd_dev_size,
 		(fd_dev->fbd_flags & FDBD_HAS_BUFFERED_IO_WCE) ?
-		"Buffered-WCE" : "O_DSYNC");
+		"Buffered-WCE" : "O_DSYNC",
+		(fd_dev->fbd_flags & FDBD_HAS_WRITE_BEHIND) ?
+		" Write-Behind" : "",
+		(fd_dev->fbd_flags & FDBD_HAS_ASYNC_IO) ? " Async" : "");
 	return bl;
 }
 
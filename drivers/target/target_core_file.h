@@ -19,6 +19,8 @@
 #define FBDF_HAS_PATH		0x01
 #define FBDF_HAS_SIZE		0x02
 #define FDBD_HAS_BUFFERED_IO_WCE 0x04
+#define FDBD_HAS_ASYNC_IO	0x08
+#define FDBD_HAS_WRITE_BEHIND	0x10
 #define FDBD_FORMAT_UNIT_SIZE	2048
 
 struct fd_prot {
@@ -27,6 +29,18 @@ struct fd_prot {
 	u32 prot_sg_nents;
 };
 
+/*
+ * One outstanding READ/WRITE handed off to fd_dev->fd_wq when
+ * fd_async_io=1 is set.
+ */
+struct fd_async_req {
+	struct work_struct	work;
+	struct se_cmd		*cmd;
+	struct scatterlist	*sgl;
+	u32			sgl_nents;
+	enum dma_data_direction	data_direction;
+};
+
 struct fd_dev {
 	struct se_device dev;
 
@@ -41,6 +55,8 @@ struct fd_dev {
 	unsigned long long fd_dev_size;
 	struct file	*fd_file;
 	struct file	*fd_prot_file;
+	/* Per device workqueue for fd_async_io=1 READ/WRITE submission */
+	struct workqueue_struct *fd_wq;
 	/* FILEIO HBA device is connected to */
 	struct fd_host *fd_host;
 } ____cacheline_aligned;
@@ -34,6 +34,9 @@
 #include <linux/utsname.h>
 #include <linux/coredump.h>
 #include <linux/sched.h>
+#include <linux/hash.h>
+#include <linux/rculist.h>
+#include <linux/moduleparam.h>
 #include <asm/uaccess.h>
 #include <asm/param.h>
 #include <asm/page.h>
@@ -387,6 +390,195 @@ static unsigned long total_mapping_size(struct elf_phdr *cmds, int nr)
 }
 
 
+/*
+ * Cache of parsed program headers, keyed by file identity.  Job launchers
+ * exec the same handful of large binaries (and the same ld.so) over and
+ * over; this saves re-reading and re-validating their program headers and
+ * PT_INTERP path on every exec.
+ *
+ * Entries are keyed by superblock, inode number and generation rather than
+ * by the (unpinned) inode, and are only used while the inode's i_version,
+ * size and timestamps are unchanged, so neither a recycled inode nor a
+ * rewritten file can pick up somebody else's headers.  Exec holds
+ * deny_write_access() on the file, so it cannot change underneath us while
+ * the copy is in use.  Lookups only take the RCU read lock and, apart from
+ * setting an entry's referenced flag once, write nothing shared; the
+ * spinlock is only for inserting after a miss.
+ *
+ * Off by default; enable it with binfmt_elf.elf_layout_cache=1.
+ */
+#define ELF_LAYOUT_HASH_BITS	6
+#define ELF_LAYOUT_MAX		256
+
+struct elf_layout {
+	struct hlist_node hash;
+	struct list_head lru;
+	struct rcu_head rcu;
+	const struct super_block *sb;	/* only compared, never dereferenced */
+	unsigned long ino;
+	u32 generation;
+	u64 version;
+	loff_t isize;
+	struct timespec mtime;
+	struct timespec ctime;
+	elf_addr_t phoff;
+	unsigned int phnum;
+	unsigned int interp_len;	/* with the NUL; 0 for static binaries */
+	bool referenced;		/* used since the LRU scan last came by */
+	struct elf_phdr phdrs[0];	/* followed by the interpreter path */
+};
+
+static struct hlist_head elf_layout_hash[1 << ELF_LAYOUT_HASH_BITS];
+static LIST_HEAD(elf_layout_lru);
+static unsigned int elf_layout_nr;
+static DEFINE_SPINLOCK(elf_layout_lock);
+
+static bool elf_layout_cache;
+module_param(elf_layout_cache, bool, 0644);
+MODULE_PARM_DESC(elf_layout_cache, "Cache parsed ELF program headers per inode");
+
+static unsigned int elf_prefault_pages;
+module_param(elf_prefault_pages, uint, 0644);
+MODULE_PARM_DESC(elf_prefault_pages,
+		 "Number of text pages to fault in at exec time");
+
+static struct hlist_head *elf_layout_bucket(const struct inode *inode)
+{
+	unsigned long key = inode->i_ino ^ (unsigned long)inode->i_sb;
+
+	return &elf_layout_hash[hash_long(key, ELF_LAYOUT_HASH_BITS)];
+}
+
+static bool elf_layout_same_file(const struct elf_layout *el,
+				 const struct inode *inode)
+{
+	return el->sb == inode->i_sb && el->ino == inode->i_ino &&
+	       el->generation == inode->i_generation;
+}
+
+static bool elf_layout_match(const struct elf_layout *el,
+			     const struct inode *inode,
+			     const struct elfhdr *ex)
+{
+	return el->version == inode->i_version &&
+	       el->isize == i_size_read(inode) &&
+	       timespec_equal(&el->mtime, &inode->i_mtime) &&
+	       timespec_equal(&el->ctime, &inode->i_ctime) &&
+	       el->phoff == ex->e_phoff && el->phnum == ex->e_phnum;
+}
+
+static char *elf_layout_interp(struct elf_layout *el)
+{
+	return (char *)&el->phdrs[el->phnum];
+}
+
+/* Must be called with elf_layout_lock held */
+static void elf_layout_unhash(struct elf_layout *el)
+{
+	hlist_del_rcu(&el->hash);
+	list_del(&el->lru);
+	elf_layout_nr--;
+	kfree_rcu(el, rcu);
+}
+
+/*
+ * Copy the cached program headers for @file into @phdrs.  If @interp is
+ * non-NULL it receives a copy of the cached interpreter path, or NULL for a
+ * static binary.  Returns false if nothing usable is cached; a stale entry
+ * is replaced by the caller's elf_layout_insert() after the slow path.
+ */
+static bool elf_layout_lookup(struct file *file, const struct elfhdr *ex,
+			      struct elf_phdr *phdrs, char **interp)
+{
+	struct inode *inode = file_inode(file);
+	struct elf_layout *el;
+	bool ret = false;
+
+	if (!elf_layout_cache)
+		return false;
+
+	rcu_read_lock();
+	hlist_for_each_entry_rcu(el, elf_layout_bucket(inode), hash) {
+		if (!elf_layout_same_file(el, inode))
+			continue;
+		if (!elf_layout_match(el, inode, ex))
+			break;
+		if (interp) {
+			*interp = NULL;
+			if (el->interp_len) {
+				/* Can't sleep here; fall back to the slow path */
+				*interp = kmemdup(elf_layout_interp(el),
+						  el->interp_len,
+						  GFP_NOWAIT | __GFP_NOWARN);
+				if (!*interp)
+					break;
+			}
+		}
+		memcpy(phdrs, el->phdrs, el->phnum * sizeof(struct elf_phdr));
+		if (!ACCESS_ONCE(el->referenced))
+			ACCESS_ONCE(el->referenced) = true;
+		ret = true;
+		break;
+	}
+	rcu_read_unlock();
+
+	return ret;
+}
+
+static void elf_layout_insert(struct file *file, const struct elfhdr *ex,
+			      const struct elf_phdr *phdrs, const char *interp)
+{
+	struct inode *inode = file_inode(file);
+	size_t size = ex->e_phnum * sizeof(struct elf_phdr);
+	size_t interp_len = interp ? strlen(interp) + 1 : 0;
+	struct hlist_head *head = elf_layout_bucket(inode);
+	struct elf_layout *el, *old;
+	unsigned int scanned = 0;
+
+	if (!elf_layout_cache || size > ELF_MIN_ALIGN)
+		return;
+
+	el = kmalloc(sizeof(*el) + size + interp_len, GFP_KERNEL);
+	if (!el)
+		return;
+	el->sb = inode->i_sb;
+	el->ino = inode->i_ino;
+	el->generation = inode->i_generation;
+	el->version = inode->i_version;
+	el->isize = i_size_read(inode);
+	el->mtime = inode->i_mtime;
+	el->ctime = inode->i_ctime;
+	el->phoff = ex->e_phoff;
+	el->phnum = ex->e_phnum;
+	el->interp_len = interp_len;
+	el->referenced = false;
+	memcpy(el->phdrs, phdrs, size);
+	if (interp)
+		memcpy(elf_layout_interp(el), interp, interp_len);
+
+	spin_lock(&elf_layout_lock);
+	hlist_for_each_entry(old, head, hash) {
+		if (old->sb == el->sb && old->ino == el->ino) {
+			elf_layout_unhash(old);
+			break;
+		}
+	}
+	while (elf_layout_nr >= ELF_LAYOUT_MAX) {
+		/* Give entries used since the last pass a second chance */
+		old = list_entry(elf_layout_lru.prev, struct elf_layout, lru);
+		if (old->referenced && scanned++ < ELF_LAYOUT_MAX) {
+			old->referenced = false;
+			list_move(&old->lru, &elf_layout_lru);
+			continue;
+		}
+		elf_layout_unhash(old);
+	}
+	hlist_add_head_rcu(&el->hash, head);
+	list_add(&el->lru, &elf_layout_lru);
+	elf_layout_nr++;
+	spin_unlock(&elf_layout_lock);
+}
+
 /* This is much more generalized than the library routine read function,
    so we keep this separate.  Technically the library read function
    is only provided so that we can read a.out libraries that have
@@ -432,13 +624,16 @@ static unsigned long load_elf_interp(struct elfhdr *interp_elf_ex,
 	if (!elf_phdata)
 		goto out;
 
-	retval = kernel_read(interpreter, interp_elf_ex->e_phoff,
-			     (char *)elf_phdata, size);
-	error = -EIO;
-	if (retval != size) {
-		if (retval < 0)
-			error = retval;	
-		goto out_close;
+	if (!elf_layout_lookup(interpreter, interp_elf_ex, elf_phdata, NULL)) {
+		retval = kernel_read(interpreter, interp_elf_ex->e_phoff,
+				     (char *)elf_phdata, size);
+		error = -EIO;
+		if (retval != size) {
+			if (retval < 0)
+				error = retval;
+			goto out_close;
+		}
+		elf_layout_insert(interpreter, interp_elf_ex, elf_phdata, NULL);
 	}
 
 	total_size = total_mapping_size(elf_phdata, interp_elf_ex->e_phnum);
@@ -584,6 +779,7 @@ static int load_elf_binary(struct linux_binprm *bprm)
 	unsigned long start_code, end_code, start_data, end_data;
 	unsigned long reloc_func_desc __maybe_unused = 0;
 	int executable_stack = EXSTACK_DEFAULT;
+	bool layout_cached;
 	struct pt_regs *regs = current_pt_regs();
 	struct {
 		struct elfhdr elf_ex;
@@ -623,12 +819,16 @@ static int load_elf_binary(struct linux_binprm *bprm)
 	if (!elf_phdata)
 		goto out;
 
-	retval = kernel_read(bprm->file, loc->elf_ex.e_phoff,
-			     (char *)elf_phdata, size);
-	if (retval != size) {
-		if (retval >= 0)
-			retval = -EIO;
-		goto out_free_ph;
+	layout_cached = elf_layout_lookup(bprm->file, &loc->elf_ex, elf_phdata,
+					  &elf_interpreter);
+	if (!layout_cached) {
+		retval = kernel_read(bprm->file, loc->elf_ex.e_phoff,
+				     (char *)elf_phdata, size);
+		if (retval != size) {
+			if (retval >= 0)
+				retval = -EIO;
+			goto out_free_ph;
+		}
 	}
 
 	elf_ppnt = elf_phdata;
@@ -646,6 +846,9 @@ static int load_elf_binary(struct linux_binprm *bprm)
 			 * shared libraries - for now assume that this
 			 * is an a.out format binary
 			 */
+			if (layout_cached)
+				goto open_interp;
+
 			retval = -ENOEXEC;
 			if (elf_ppnt->p_filesz > PATH_MAX || 
 			    elf_ppnt->p_filesz < 2)
@@ -669,6 +872,12 @@ static int load_elf_binary(struct linux_binprm *bprm)
 			retval = -ENOEXEC;
 			if (elf_interpreter[elf_ppnt->p_filesz - 1] != '\0')
 				goto out_free_interp;
+open_interp:
+			if (!elf_interpreter) {
+				/* cached as static, yet has PT_INTERP */
+				retval = -ENOEXEC;
+				goto out_free_ph;
+			}
 
 			interpreter = open_exec(elf_interpreter);
 			retval = PTR_ERR(interpreter);
@@ -697,6 +906,10 @@ static int load_elf_binary(struct linux_binprm *bprm)
 		elf_ppnt++;
 	}
 
+	if (!layout_cached)
+		elf_layout_insert(bprm->file, &loc->elf_ex, elf_phdata,
+				  elf_interpreter);
+
 	elf_ppnt = elf_phdata;
 	for (i = 0; i < loc->elf_ex.e_phnum; i++, elf_ppnt++)
 		if (elf_ppnt->p_type == PT_GNU_STACK) {
@@ -826,6 +1039,16 @@ static int load_elf_binary(struct linux_binprm *bprm)
 			goto out_free_dentry;
 		}
 
+		if ((elf_prot & PROT_EXEC) && elf_prefault_pages) {
+			/* Fault in the start of text rather than page by page */
+			unsigned long len = ELF_PAGEALIGN(elf_ppnt->p_filesz +
+						ELF_PAGEOFFSET(vaddr));
+
+			len = min_t(unsigned long, len,
+				    (unsigned long)elf_prefault_pages << PAGE_SHIFT);
+			mm_populate(ELF_PAGESTART(error), len);
+		}
+
 		if (!load_addr_set) {
 			load_addr_set = 1;
 			load_addr = (elf_ppnt->p_vaddr - elf_ppnt->p_offset);
@@ -2170,7 +2393,15 @@ static int elf_core_dump(struct coredump_params *cprm)
 			page = get_dump_page(addr);
 			if (page) {
 				void *kaddr = kmap(page);
-				stop = !dump_emit(cprm, kaddr, PAGE_SIZE);
+				/*
+				 * Large heaps are mostly untouched or zeroed
+				 * memory; leave a hole rather than writing
+				 * out a page of zeroes.
+				 */
+				if (!memchr_inv(kaddr, 0, PAGE_SIZE))
+					stop = !dump_skip(cprm, PAGE_SIZE);
+				else
+					stop = !dump_emit(cprm, kaddr, PAGE_SIZE);
 				kunmap(page);
 				page_cache_release(page);
 			} else
@@ -32,6 +32,8 @@
 #include <linux/writeback.h>
 #include <linux/bit_spinlock.h>
 #include <linux/slab.h>
+#include <linux/percpu.h>
+#include <linux/ktime.h>
 #include "ctree.h"
 #include "disk-io.h"
 #include "transaction.h"
@@ -743,11 +745,37 @@ static int comp_num_workspace[BTRFS_COMPRESS_TYPES];
 static atomic_t comp_alloc_workspace[BTRFS_COMPRESS_TYPES];
 static wait_queue_head_t comp_workspace_wait[BTRFS_COMPRESS_TYPES];
 
+/*
+ * Each cpu keeps the workspace it used last, so the common case never
+ * touches the shared idle list or its lock.  Waiters for a workspace
+ * steal these back before they sleep.
+ */
+static DEFINE_PER_CPU(struct list_head *,
+		      comp_cached_workspace[BTRFS_COMPRESS_TYPES]);
+
 static struct btrfs_compress_op *btrfs_compress_op[] = {
 	&btrfs_zlib_compress,
 	&btrfs_lzo_compress,
 };
 
+static const char * const btrfs_compress_names[] = {
+	"zlib",
+	"lzo",
+};
+
+/* exported through /sys/fs/btrfs/compression_stats */
+struct btrfs_compress_stats {
+	atomic64_t	compress_calls;
+	atomic64_t	compress_in;
+	atomic64_t	compress_out;
+	atomic64_t	compress_ns;
+	atomic64_t	decompress_calls;
+	atomic64_t	decompress_in;
+	atomic64_t	decompress_ns;
+};
+
+static struct btrfs_compress_stats comp_stats[BTRFS_COMPRESS_TYPES];
+
 void __init btrfs_init_compress(void)
 {
 	int i;
@@ -760,6 +788,20 @@ void __init btrfs_init_compress(void)
 	}
 }
 
+static struct list_head *steal_cached_workspace(int idx)
+{
+	struct list_head *workspace;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		workspace = xchg(&per_cpu(comp_cached_workspace[idx], cpu),
+				 NULL);
+		if (workspace)
+			return workspace;
+	}
+	return NULL;
+}
+
 /*
  * this finds an available workspace or allocates a new one
  * ERR_PTR is returned if things go bad.
@@ -775,6 +817,10 @@ static struct list_head *find_workspace(int type)
 	atomic_t *alloc_workspace		= &comp_alloc_workspace[idx];
 	wait_queue_head_t *workspace_wait	= &comp_workspace_wait[idx];
 	int *num_workspace			= &comp_num_workspace[idx];
+
+	workspace = this_cpu_xchg(comp_cached_workspace[idx], NULL);
+	if (workspace)
+		return workspace;
 again:
 	spin_lock(workspace_lock);
 	if (!list_empty(idle_workspace)) {
@@ -790,6 +836,11 @@ again:
 
 		spin_unlock(workspace_lock);
 		prepare_to_wait(workspace_wait, &wait, TASK_UNINTERRUPTIBLE);
+		workspace = steal_cached_workspace(idx);
+		if (workspace) {
+			finish_wait(workspace_wait, &wait);
+			return workspace;
+		}
 		if (atomic_read(alloc_workspace) > cpus && !*num_workspace)
 			schedule();
 		finish_wait(workspace_wait, &wait);
@@ -819,6 +870,11 @@ static void free_workspace(int type, struct list_head *workspace)
 	wait_queue_head_t *workspace_wait	= &comp_workspace_wait[idx];
 	int *num_workspace			= &comp_num_workspace[idx];
 
+	/* park it on this cpu, and put back whatever was parked there */
+	workspace = this_cpu_xchg(comp_cached_workspace[idx], workspace);
+	if (!workspace)
+		goto wake;
+
 	spin_lock(workspace_lock);
 	if (*num_workspace < num_online_cpus()) {
 		list_add_tail(workspace, idle_workspace);
@@ -845,6 +901,10 @@ static void free_workspaces(void)
 	int i;
 
 	for (i = 0; i < BTRFS_COMPRESS_TYPES; i++) {
+		while ((workspace = steal_cached_workspace(i))) {
+			btrfs_compress_op[i]->free_workspace(workspace);
+			atomic_dec(&comp_alloc_workspace[i]);
+		}
 		while (!list_empty(&comp_idle_workspace[i])) {
 			workspace = comp_idle_workspace[i].next;
 			list_del(workspace);
@@ -882,18 +942,28 @@ int btrfs_compress_pages(int type, struct address_space *mapping,
 			 unsigned long *total_out,
 			 unsigned long max_out)
 {
+	struct btrfs_compress_stats *stats = &comp_stats[type - 1];
 	struct list_head *workspace;
+	ktime_t start_time;
 	int ret;
 
 	workspace = find_workspace(type);
 	if (IS_ERR(workspace))
 		return -1;
 
+	start_time = ktime_get();
 	ret = btrfs_compress_op[type-1]->compress_pages(workspace, mapping,
 						      start, len, pages,
 						      nr_dest_pages, out_pages,
 						      total_in, total_out,
 						      max_out);
+	atomic64_add(ktime_to_ns(ktime_sub(ktime_get(), start_time)),
+		     &stats->compress_ns);
+	atomic64_inc(&stats->compress_calls);
+	if (!ret) {
+		atomic64_add(*total_in, &stats->compress_in);
+		atomic64_add(*total_out, &stats->compress_out);
+	}
 	free_workspace(type, workspace);
 	return ret;
 }
@@ -918,16 +988,23 @@ static int btrfs_decompress_biovec(int type, struct page **pages_in,
 				   u64 disk_start, struct bio_vec *bvec,
 				   int vcnt, size_t srclen)
 {
+	struct btrfs_compress_stats *stats = &comp_stats[type - 1];
 	struct list_head *workspace;
+	ktime_t start_time;
 	int ret;
 
 	workspace = find_workspace(type);
 	if (IS_ERR(workspace))
 		return -ENOMEM;
 
+	start_time = ktime_get();
 	ret = btrfs_compress_op[type-1]->decompress_biovec(workspace, pages_in,
 							 disk_start,
 							 bvec, vcnt, srclen);
+	atomic64_add(ktime_to_ns(ktime_sub(ktime_get(), start_time)),
+		     &stats->decompress_ns);
+	atomic64_inc(&stats->decompress_calls);
+	atomic64_add(srclen, &stats->decompress_in);
 	free_workspace(type, workspace);
 	return ret;
 }
@@ -960,6 +1037,37 @@ void btrfs_exit_compress(void)
 	free_workspaces();
 }
 
+/*
+ * One line per algorithm: calls, bytes in and out and time spent
+ * compressing, then calls, compressed bytes read and time spent
+ * decompressing extents.
+ */
+ssize_t btrfs_compress_stats_show(char *buf)
+{
+	ssize_t len = 0;
+	int i;
+
+	len += scnprintf(buf + len, PAGE_SIZE - len,
+			 "%-5s %10s %14s %14s %14s %10s %14s %14s\n", "type",
+			 "c_calls", "c_in", "c_out", "c_ns",
+			 "d_calls", "d_in", "d_ns");
+	for (i = 0; i < BTRFS_COMPRESS_TYPES; i++) {
+		struct btrfs_compress_stats *stats = &comp_stats[i];
+
+		len += scnprintf(buf + len, PAGE_SIZE - len,
+			"%-5s %10lld %14lld %14lld %14lld %10lld %14lld %14lld\n",
+			btrfs_compress_names[i],
+			(long long)atomic64_read(&stats->compress_calls),
+			(long long)atomic64_read(&stats->compress_in),
+			(long long)atomic64_read(&stats->compress_out),
+			(long long)atomic64_read(&stats->compress_ns),
+			(long long)atomic64_read(&stats->decompress_calls),
+			(long long)atomic64_read(&stats->decompress_in),
+			(long long)atomic64_read(&stats->decompress_ns));
+	}
+	return len;
+}
+
 /*
  * Copy uncompressed data from working buffer to pages.
  *
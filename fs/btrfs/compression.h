@@ -21,6 +21,7 @@
 
 void btrfs_init_compress(void);
 void btrfs_exit_compress(void);
+ssize_t btrfs_compress_stats_show(char *buf);
 
 int btrfs_compress_pages(int type, struct address_space *mapping,
 			 u64 start, unsigned long len,
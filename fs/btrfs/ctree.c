@@ -2698,6 +2698,89 @@ int btrfs_find_item(struct btrfs_root *fs_root, struct btrfs_path *found_path,
 	return 0;
 }
 
+/*
+ * Optimistic lookup for plain read-only searches.  We walk down from the
+ * root without taking any tree locks, sampling each node's write_seq
+ * before looking at it and checking it again once the child pointer has
+ * been read.  Only cached, uptodate blocks are followed.  Once we reach
+ * the leaf we read lock it and make sure neither it nor any node above it
+ * was write locked in the meantime: every cow, split, merge or key update
+ * along the path write locks the nodes it changes, so an unchanged path
+ * means the leaf we hold is the one a locked search would have found.
+ *
+ * Returns -EAGAIN with the path released if the caller has to do a
+ * regular locked search instead.
+ */
+static int search_slot_optimistic(struct btrfs_root *root,
+				  struct btrfs_key *key, struct btrfs_path *p)
+{
+	unsigned seq[BTRFS_MAX_LEVEL];
+	struct extent_buffer *b;
+	struct extent_buffer *tmp;
+	int prev_cmp = -1;
+	int level;
+	int slot;
+	int ret;
+	u64 blocknr;
+	u64 gen;
+
+	b = btrfs_root_node(root);
+	level = btrfs_header_level(b);
+	if (level >= BTRFS_MAX_LEVEL) {
+		free_extent_buffer(b);
+		return -EAGAIN;
+	}
+	p->nodes[level] = b;
+	seq[level] = raw_seqcount_begin(&b->write_seq);
+
+	while (level > 0) {
+		if (atomic_read(&b->write_locks) ||
+		    btrfs_header_nritems(b) > BTRFS_NODEPTRS_PER_BLOCK(root))
+			goto fail;
+
+		ret = key_search(b, key, level, &prev_cmp, &slot);
+		if (ret && slot > 0)
+			slot -= 1;
+		p->slots[level] = slot;
+		blocknr = btrfs_node_blockptr(b, slot);
+		gen = btrfs_node_ptr_generation(b, slot);
+		if (read_seqcount_retry(&b->write_seq, seq[level]))
+			goto fail;
+
+		tmp = btrfs_find_tree_block(root, blocknr,
+					    btrfs_level_size(root, level - 1));
+		if (!tmp)
+			goto fail;
+		if (btrfs_buffer_uptodate(tmp, gen, 1) <= 0 ||
+		    btrfs_header_level(tmp) != level - 1) {
+			free_extent_buffer(tmp);
+			goto fail;
+		}
+
+		level--;
+		b = tmp;
+		p->nodes[level] = b;
+		seq[level] = raw_seqcount_begin(&b->write_seq);
+	}
+
+	if (!btrfs_try_tree_read_lock(b))
+		goto fail;
+	p->locks[0] = BTRFS_READ_LOCK;
+
+	for (level = 0; level < BTRFS_MAX_LEVEL && p->nodes[level]; level++)
+		if (read_seqcount_retry(&p->nodes[level]->write_seq,
+					seq[level]))
+			goto fail;
+
+	ret = key_search(b, key, 0, &prev_cmp, &slot);
+	p->slots[0] = slot;
+	return ret;
+
+fail:
+	btrfs_release_path(p);
+	return -EAGAIN;
+}
+
 /*
  * look for key in the tree.  path is filled in with nodes along the way
  * if key is found, we return zero and you can find the item in the leaf
@@ -2757,6 +2840,16 @@ int btrfs_search_slot(struct btrfs_trans_handle *trans, struct btrfs_root
 
 	min_write_lock_level = write_lock_level;
 
+	if (!cow && !lowest_level && !p->keep_locks && !p->skip_locking &&
+	    !p->search_commit_root) {
+		ret = search_slot_optimistic(root, key, p);
+		if (ret != -EAGAIN) {
+			if (!p->leave_spinning)
+				btrfs_set_path_blocking(p);
+			return ret;
+		}
+	}
+
 again:
 	prev_cmp = -1;
 	/*
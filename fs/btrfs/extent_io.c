@@ -4397,6 +4397,7 @@ __alloc_extent_buffer(struct btrfs_fs_info *fs_info, u64 start,
 	eb->fs_info = fs_info;
 	eb->bflags = 0;
 	rwlock_init(&eb->lock);
+	seqcount_init(&eb->write_seq);
 	atomic_set(&eb->write_locks, 0);
 	atomic_set(&eb->read_locks, 0);
 	atomic_set(&eb->blocking_readers, 0);
@@ -149,6 +149,12 @@ struct extent_buffer {
 	/* protects write locks */
 	rwlock_t lock;
 
+	/*
+	 * bumped when a write lock is taken and again when it is dropped,
+	 * lets lockless readers in btrfs_search_slot validate what they saw
+	 */
+	seqcount_t write_seq;
+
 	/* readers use lock_wq while they wait for the write
 	 * lock holders to unlock
 	 */
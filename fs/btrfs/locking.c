@@ -160,6 +160,7 @@ int btrfs_try_tree_write_lock(struct extent_buffer *eb)
 	atomic_inc(&eb->write_locks);
 	atomic_inc(&eb->spinning_writers);
 	eb->lock_owner = current->pid;
+	raw_write_seqcount_begin(&eb->write_seq);
 	return 1;
 }
 
@@ -232,6 +233,7 @@ again:
 	atomic_inc(&eb->spinning_writers);
 	atomic_inc(&eb->write_locks);
 	eb->lock_owner = current->pid;
+	raw_write_seqcount_begin(&eb->write_seq);
 }
 
 /*
@@ -244,6 +246,7 @@ void btrfs_tree_unlock(struct extent_buffer *eb)
 	BUG_ON(blockers > 1);
 
 	btrfs_assert_tree_locked(eb);
+	raw_write_seqcount_end(&eb->write_seq);
 	atomic_dec(&eb->write_locks);
 
 	if (blockers) {
@@ -31,6 +31,7 @@
 #include "transaction.h"
 #include "sysfs.h"
 #include "volumes.h"
+#include "compression.h"
 
 static inline struct btrfs_fs_info *to_fs_info(struct kobject *kobj);
 
@@ -601,6 +602,13 @@ static int add_device_membership(struct btrfs_fs_info *fs_info)
 /* /sys/fs/btrfs/ entry */
 static struct kset *btrfs_kset;
 
+static ssize_t compression_stats_show(struct kobject *kobj,
+				      struct kobj_attribute *a, char *buf)
+{
+	return btrfs_compress_stats_show(buf);
+}
+BTRFS_ATTR(compression_stats, 0444, compression_stats_show);
+
 /* /sys/kernel/debug/btrfs */
 static struct dentry *btrfs_debugfs_root_dentry;
 
@@ -673,16 +681,31 @@ int btrfs_init_sysfs(void)
 
 	ret = btrfs_init_debugfs();
 	if (ret)
-		return ret;
+		goto out1;
 
 	init_feature_attrs();
 	ret = sysfs_create_group(&btrfs_kset->kobj, &btrfs_feature_attr_group);
+	if (ret)
+		goto out2;
 
+	ret = sysfs_create_file(&btrfs_kset->kobj,
+				BTRFS_ATTR_PTR(compression_stats));
+	if (ret)
+		goto out3;
+
+	return 0;
+out3:
+	sysfs_remove_group(&btrfs_kset->kobj, &btrfs_feature_attr_group);
+out2:
+	debugfs_remove_recursive(btrfs_debugfs_root_dentry);
+out1:
+	kset_unregister(btrfs_kset);
 	return ret;
 }
 
 void btrfs_exit_sysfs(void)
 {
+	sysfs_remove_file(&btrfs_kset->kobj, BTRFS_ATTR_PTR(compression_stats));
 	sysfs_remove_group(&btrfs_kset->kobj, &btrfs_feature_attr_group);
 	kset_unregister(btrfs_kset);
 	debugfs_remove_recursive(btrfs_debugfs_root_dentry);
@@ -11,6 +11,7 @@
 
 #include <linux/slab.h>
 #include <linux/mount.h>
+#include <linux/file.h>
 #include "internal.h"
 
 struct cachefiles_lookup_data {
@@ -49,6 +50,7 @@ static struct fscache_object *cachefiles_alloc_object(
 		goto nomem_object;
 
 	ASSERTCMP(object->backer, ==, NULL);
+	ASSERTCMP(object->backing_file, ==, NULL);
 
 	BUG_ON(test_bit(CACHEFILES_OBJECT_ACTIVE, &object->flags));
 	atomic_set(&object->usage, 1);
@@ -269,6 +271,12 @@ static void cachefiles_drop_object(struct fscache_object *_object)
 	ASSERT((atomic_read(&object->usage) & 0xffff0000) != 0x6b6b0000);
 #endif
 
+	/* close the backing file before the backer is possibly buried */
+	if (object->backing_file) {
+		fput(object->backing_file);
+		object->backing_file = NULL;
+	}
+
 	/* delete retired objects */
 	if (test_bit(FSCACHE_OBJECT_RETIRED, &object->fscache.flags) &&
 	    _object != cache->cache.fsdef
@@ -329,6 +337,7 @@ static void cachefiles_put_object(struct fscache_object *_object)
 		ASSERT(!test_bit(CACHEFILES_OBJECT_ACTIVE, &object->flags));
 		ASSERTCMP(object->fscache.parent, ==, NULL);
 		ASSERTCMP(object->backer, ==, NULL);
+		ASSERTCMP(object->backing_file, ==, NULL);
 		ASSERTCMP(object->dentry, ==, NULL);
 		ASSERTCMP(object->fscache.n_ops, ==, 0);
 		ASSERTCMP(object->fscache.n_children, ==, 0);
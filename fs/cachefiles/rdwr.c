@@ -13,6 +13,7 @@
 #include <linux/slab.h>
 #include <linux/file.h>
 #include <linux/swap.h>
+#include <linux/blkdev.h>
 #include "internal.h"
 
 /*
@@ -465,6 +466,52 @@ enobufs:
 	return -ENOBUFS;
 }
 
+/*
+ * start reading all the backing pages that aren't yet in the pagecache in one
+ * go, so that the backing filesystem can build large bios out of them rather
+ * than being handed one page at a time through ->readpage()
+ * - the pages are left locked in the backing pagecache with I/O in flight, so
+ *   the caller will find them and just install monitors
+ * - this is only a hint; anything we fail to allocate gets read individually
+ */
+static void cachefiles_readahead_backing_file(struct address_space *bmapping,
+					      struct list_head *list)
+{
+	LIST_HEAD(page_pool);
+	struct blk_plug plug;
+	struct page *netpage, *page;
+	unsigned nr_pages = 0;
+
+	list_for_each_entry(netpage, list, lru) {
+		rcu_read_lock();
+		page = radix_tree_lookup(&bmapping->page_tree, netpage->index);
+		rcu_read_unlock();
+		if (page && !radix_tree_exceptional_entry(page))
+			continue;
+
+		page = __page_cache_alloc(cachefiles_gfp | __GFP_COLD);
+		if (!page)
+			break;
+		page->index = netpage->index;
+
+		/* ->readpages() expects the list in reverse index order, as
+		 * the readahead code builds it */
+		list_add(&page->lru, &page_pool);
+		nr_pages++;
+	}
+
+	if (!nr_pages)
+		return;
+
+	_debug("readahead %u", nr_pages);
+
+	blk_start_plug(&plug);
+	bmapping->a_ops->readpages(NULL, bmapping, &page_pool, nr_pages);
+	/* clean up the remains of the list */
+	put_pages_list(&page_pool);
+	blk_finish_plug(&plug);
+}
+
 /*
  * read the corresponding pages to the given set from the backing file
  * - any uncertain pages are simply discarded, to be tried again another time
@@ -480,6 +527,8 @@ static int cachefiles_read_backing_file(struct cachefiles_object *object,
 
 	_enter("");
 
+	cachefiles_readahead_backing_file(bmapping, list);
+
 	list_for_each_entry_safe(netpage, _n, list, lru) {
 		list_del(&netpage->lru);
 
@@ -886,7 +935,6 @@ int cachefiles_write_page(struct fscache_storage *op, struct page *page)
 {
 	struct cachefiles_object *object;
 	struct cachefiles_cache *cache;
-	mm_segment_t old_fs;
 	struct file *file;
 	struct path path;
 	loff_t pos, eof;
@@ -912,47 +960,48 @@ int cachefiles_write_page(struct fscache_storage *op, struct page *page)
 	cache = container_of(object->fscache.cache,
 			     struct cachefiles_cache, cache);
 
-	/* write the page to the backing filesystem and let it store it in its
-	 * own time */
-	path.mnt = cache->mnt;
-	path.dentry = object->backer;
-	file = dentry_open(&path, O_RDWR | O_LARGEFILE, cache->cache_cred);
-	if (IS_ERR(file)) {
-		ret = PTR_ERR(file);
-	} else {
-		ret = -EIO;
-		if (file->f_op->write) {
-			pos = (loff_t) page->index << PAGE_SHIFT;
-
-			/* we mustn't write more data than we have, so we have
-			 * to beware of a partial page at EOF */
-			eof = object->fscache.store_limit_l;
-			len = PAGE_SIZE;
-			if (eof & ~PAGE_MASK) {
-				ASSERTCMP(pos, <, eof);
-				if (eof - pos < PAGE_SIZE) {
-					_debug("cut short %llx to %llx",
-					       pos, eof);
-					len = eof - pos;
-					ASSERTCMP(pos + len, ==, eof);
-				}
-			}
+	/* the backing file is opened on the first store and kept open until
+	 * the object is dropped, rather than being reopened for every page;
+	 * only the storage op writes to the object, so there's no race to
+	 * open it */
+	file = object->backing_file;
+	if (!file) {
+		path.mnt = cache->mnt;
+		path.dentry = object->backer;
+		file = dentry_open(&path, O_RDWR | O_LARGEFILE,
+				   cache->cache_cred);
+		if (IS_ERR(file)) {
+			ret = PTR_ERR(file);
+			goto error;
+		}
+		object->backing_file = file;
+	}
 
-			data = kmap(page);
-			file_start_write(file);
-			old_fs = get_fs();
-			set_fs(KERNEL_DS);
-			ret = file->f_op->write(
-				file, (const void __user *) data, len, &pos);
-			set_fs(old_fs);
-			kunmap(page);
-			file_end_write(file);
-			if (ret != len)
-				ret = -EIO;
+	/* write the page to the backing filesystem and let it store it in its
+	 * own time - writeback will gather runs of adjacent pages from the
+	 * batch the storage op hands us into large bios */
+	pos = (loff_t) page->index << PAGE_SHIFT;
+
+	/* we mustn't write more data than we have, so we have to beware of a
+	 * partial page at EOF */
+	eof = object->fscache.store_limit_l;
+	len = PAGE_SIZE;
+	if (eof & ~PAGE_MASK) {
+		ASSERTCMP(pos, <, eof);
+		if (eof - pos < PAGE_SIZE) {
+			_debug("cut short %llx to %llx", pos, eof);
+			len = eof - pos;
+			ASSERTCMP(pos + len, ==, eof);
 		}
-		fput(file);
 	}
 
+	data = kmap(page);
+	ret = kernel_write(file, data, len, pos);
+	kunmap(page);
+	if (ret != len)
+		ret = -EIO;
+
+error:
 	if (ret < 0) {
 		if (ret == -EIO)
 			cachefiles_io_error_obj(
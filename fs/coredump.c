@@ -32,6 +32,10 @@
 #include <linux/pipe_fs_i.h>
 #include <linux/oom.h>
 #include <linux/compat.h>
+#include <linux/vmalloc.h>
+#include <linux/zlib.h>
+#include <linux/ktime.h>
+#include <linux/ratelimit.h>
 
 #include <asm/uaccess.h>
 #include <asm/mmu_context.h>
@@ -46,6 +50,9 @@
 int core_uses_pid;
 unsigned int core_pipe_limit;
 char core_pattern[CORENAME_MAX_SIZE] = "core";
+#ifdef CONFIG_COREDUMP_COMPRESS
+int core_compress;
+#endif
 static int core_name_size = CORENAME_MAX_SIZE;
 
 struct core_name {
@@ -489,6 +496,122 @@ static int umh_pipe_setup(struct subprocess_info *info, struct cred *new)
 	return err;
 }
 
+#ifdef CONFIG_COREDUMP_COMPRESS
+struct coredump_zstream {
+	struct z_stream_s strm;
+	void *buf;
+};
+
+static void dump_compress_free(struct coredump_params *cprm)
+{
+	struct coredump_zstream *zs = cprm->zs;
+
+	if (!zs)
+		return;
+	vfree(zs->strm.workspace);
+	free_page((unsigned long)zs->buf);
+	kfree(zs);
+	cprm->zs = NULL;
+}
+
+static void dump_compress_start(struct coredump_params *cprm)
+{
+	struct coredump_zstream *zs;
+	int level = ACCESS_ONCE(core_compress);
+
+	if (!level)
+		return;
+
+	zs = kzalloc(sizeof(*zs), GFP_KERNEL);
+	if (!zs)
+		goto fail;
+	cprm->zs = zs;
+	zs->buf = (void *)__get_free_page(GFP_KERNEL);
+	zs->strm.workspace = vmalloc(zlib_deflate_workspacesize(MAX_WBITS,
+								DEF_MEM_LEVEL));
+	if (!zs->buf || !zs->strm.workspace)
+		goto fail;
+	if (zlib_deflateInit(&zs->strm, level) != Z_OK)
+		goto fail;
+	return;
+fail:
+	dump_compress_free(cprm);
+	printk(KERN_WARNING "Pid %d(%s) core dump compression unavailable, "
+	       "dumping uncompressed\n", task_tgid_vnr(current), current->comm);
+}
+
+static int dump_write(struct coredump_params *cprm, const void *addr, int nr);
+
+/* Feed @nr bytes through the compressor, writing out whatever it produces */
+static int dump_deflate(struct coredump_params *cprm, const void *addr, int nr,
+			int flush)
+{
+	struct coredump_zstream *zs = cprm->zs;
+	int ret, len;
+
+	zs->strm.next_in = addr;
+	zs->strm.avail_in = nr;
+	do {
+		zs->strm.next_out = zs->buf;
+		zs->strm.avail_out = PAGE_SIZE;
+		ret = zlib_deflate(&zs->strm, flush);
+		if (ret != Z_OK && ret != Z_STREAM_END)
+			return 0;
+		len = PAGE_SIZE - zs->strm.avail_out;
+		if (len && !dump_write(cprm, zs->buf, len))
+			return 0;
+	} while (zs->strm.avail_out == 0);
+
+	return 1;
+}
+
+static int dump_compress_finish(struct coredump_params *cprm)
+{
+	int ret = 1;
+
+	if (cprm->zs) {
+		ret = dump_deflate(cprm, NULL, 0, Z_FINISH);
+		zlib_deflateEnd(&cprm->zs->strm);
+		dump_compress_free(cprm);
+	}
+	return ret;
+}
+#else
+static inline void dump_compress_start(struct coredump_params *cprm) { }
+static inline int dump_compress_finish(struct coredump_params *cprm)
+{
+	return 1;
+}
+#endif
+
+/*
+ * A dump that ends in skipped (zero) pages leaves the file short of its
+ * logical size; extend it so the final hole reads back as zeroes.
+ */
+static int dump_truncate(struct coredump_params *cprm)
+{
+	struct file *file = cprm->file;
+
+	if (cprm->zs || !file->f_op->llseek || file->f_op->llseek == no_llseek)
+		return 1;
+	if (i_size_read(file->f_mapping->host) >= file->f_pos)
+		return 1;
+	return do_truncate(file->f_path.dentry, file->f_pos, 0, file) == 0;
+}
+
+static void dump_report(struct coredump_params *cprm, ktime_t start)
+{
+	u64 usecs = ktime_to_us(ktime_sub(ktime_get(), start));
+	u64 kbps = div64_u64((u64)cprm->written * USEC_PER_SEC,
+			     max_t(u64, usecs, 1) * 1024);
+
+	printk_ratelimited(KERN_INFO "Pid %d(%s) dumped core: %lld bytes, "
+			   "%lld stored, %llu ms, %llu KiB/s\n",
+			   task_tgid_vnr(current), current->comm,
+			   cprm->written, cprm->stored,
+			   div_u64(usecs, USEC_PER_MSEC), kbps);
+}
+
 void do_coredump(const siginfo_t *siginfo)
 {
 	struct core_state core_state;
@@ -662,13 +785,24 @@ void do_coredump(const siginfo_t *siginfo)
 	if (displaced)
 		put_files_struct(displaced);
 	if (!dump_interrupted()) {
+		ktime_t start = ktime_get();
+
+		dump_compress_start(&cprm);
 		file_start_write(cprm.file);
 		core_dumped = binfmt->core_dump(&cprm);
+		if (core_dumped)
+			core_dumped = dump_compress_finish(&cprm) &&
+				      dump_truncate(&cprm);
 		file_end_write(cprm.file);
+		if (core_dumped)
+			dump_report(&cprm, start);
 	}
 	if (ispipe && core_pipe_limit)
 		wait_for_dump_helpers(cprm.file);
 close_fail:
+#ifdef CONFIG_COREDUMP_COMPRESS
+	dump_compress_free(&cprm);
+#endif
 	if (cprm.file)
 		filp_close(cprm.file, NULL);
 fail_dropcount:
@@ -689,13 +823,11 @@ fail:
  * do on a core-file: use only these functions to write out all the
  * necessary info.
  */
-int dump_emit(struct coredump_params *cprm, const void *addr, int nr)
+static int dump_write(struct coredump_params *cprm, const void *addr, int nr)
 {
 	struct file *file = cprm->file;
 	loff_t pos = file->f_pos;
 	ssize_t n;
-	if (cprm->written + nr > cprm->limit)
-		return 0;
 	while (nr) {
 		if (dump_interrupted())
 			return 0;
@@ -703,18 +835,37 @@ int dump_emit(struct coredump_params *cprm, const void *addr, int nr)
 		if (n <= 0)
 			return 0;
 		file->f_pos = pos;
-		cprm->written += n;
+		cprm->stored += n;
+		addr += n;
 		nr -= n;
 	}
 	return 1;
 }
+
+int dump_emit(struct coredump_params *cprm, const void *addr, int nr)
+{
+	int ret;
+
+	if (cprm->written + nr > cprm->limit)
+		return 0;
+#ifdef CONFIG_COREDUMP_COMPRESS
+	if (cprm->zs)
+		ret = dump_deflate(cprm, addr, nr, Z_NO_FLUSH);
+	else
+#endif
+		ret = dump_write(cprm, addr, nr);
+	if (ret)
+		cprm->written += nr;
+	return ret;
+}
 EXPORT_SYMBOL(dump_emit);
 
 int dump_skip(struct coredump_params *cprm, size_t nr)
 {
 	static char zeroes[PAGE_SIZE];
 	struct file *file = cprm->file;
-	if (file->f_op->llseek && file->f_op->llseek != no_llseek) {
+	if (!cprm->zs &&
+	    file->f_op->llseek && file->f_op->llseek != no_llseek) {
 		if (cprm->written + nr > cprm->limit)
 			return 0;
 		if (dump_interrupted() ||
@@ -45,6 +45,13 @@
  */
 #define DIO_PAGES	64
 
+/*
+ * Largest request, in user pages, handled by dio_simple_IO().  A bio_alloc()
+ * for this many vectors is satisfied from the bio's inline bio_vecs, so the
+ * whole request costs a single slab allocation.
+ */
+#define DIO_SIMPLE_PAGES	4
+
 /*
  * This code generally works in units of "dio_blocks".  A dio_block is
  * somewhere between the hard sector size and the filesystem block size.  it
@@ -1080,6 +1087,116 @@ static inline int drop_refcount(struct dio *dio)
 	return ret2;
 }
 
+/*
+ * Fast path for small synchronous requests which are aligned to the
+ * filesystem blocksize and are backed by a single, already allocated extent.
+ * This is the common case for databases doing O_DIRECT overwrites and
+ * random reads, and it does not need any of the dio_submit machinery: the
+ * range is mapped with one get_block call, the user pages are pinned in one
+ * go, a single bio is built and we wait for it inline.  No struct dio is
+ * allocated.
+ *
+ * Some get_block implementations ignore @create and allocate for writes (ext4
+ * maps holes as unwritten extents from ext4_get_block_write()), so writes only
+ * come here when the caller passed DIO_LOOKUP_ONLY.
+ *
+ * Returns 0 if the request has to take the general path instead.  Nothing
+ * has been submitted in that case.
+ */
+static ssize_t dio_simple_IO(int rw, struct kiocb *iocb, struct inode *inode,
+	unsigned long addr, size_t len, loff_t offset, get_block_t get_block,
+	dio_iodone_t end_io, int flags)
+{
+	unsigned blkbits = inode->i_blkbits;
+	struct page *pages[DIO_SIMPLE_PAGES];
+	struct buffer_head map_bh = { 0, };
+	unsigned long first = addr >> PAGE_SHIFT;
+	int nr_pages = ((addr + len - 1) >> PAGE_SHIFT) - first + 1;
+	unsigned int page_off = addr & ~PAGE_MASK;
+	size_t left = len;
+	struct bio *bio;
+	ssize_t ret = 0;
+	int i, got;
+
+	if (nr_pages > DIO_SIMPLE_PAGES)
+		return 0;
+	/* reads past EOF are trimmed and extending writes update i_size */
+	if (offset + len > i_size_read(inode))
+		return 0;
+
+	if (rw == READ && (flags & DIO_LOCKING)) {
+		mutex_lock(&inode->i_mutex);
+		if (filemap_write_and_wait_range(iocb->ki_filp->f_mapping,
+						 offset, offset + len - 1)) {
+			mutex_unlock(&inode->i_mutex);
+			return 0;
+		}
+	}
+
+	atomic_inc(&inode->i_dio_count);
+
+	/*
+	 * Holes, unwritten extents and fragmented ranges all need the general
+	 * path.  The caller made sure this get_block call cannot allocate.
+	 */
+	map_bh.b_size = len;
+	if (get_block(inode, offset >> blkbits, &map_bh, 0) ||
+	    !buffer_mapped(&map_bh) || buffer_unwritten(&map_bh) ||
+	    buffer_new(&map_bh) || map_bh.b_size < len)
+		goto out_unlock;
+
+	got = get_user_pages_fast(addr, nr_pages, rw == READ, pages);
+	if (got < nr_pages)
+		goto out_put_pages;
+
+	bio = bio_alloc(GFP_KERNEL, nr_pages);
+	bio->bi_bdev = map_bh.b_bdev;
+	bio->bi_iter.bi_sector = map_bh.b_blocknr << (blkbits - 9);
+	for (i = 0; i < nr_pages; i++) {
+		unsigned int bytes = min_t(size_t, left, PAGE_SIZE - page_off);
+
+		if (bio_add_page(bio, pages[i], bytes, page_off) != bytes) {
+			bio_put(bio);
+			goto out_put_pages;
+		}
+		left -= bytes;
+		page_off = 0;
+	}
+
+	/* the block lookup is done, see do_blockdev_direct_IO() */
+	if (rw == READ && (flags & DIO_LOCKING))
+		mutex_unlock(&inode->i_mutex);
+
+	if (rw & WRITE)
+		task_io_account_write(len);
+
+	ret = submit_bio_wait(rw, bio);
+	bio_put(bio);
+
+	for (i = 0; i < nr_pages; i++) {
+		if (rw == READ && !PageCompound(pages[i]))
+			set_page_dirty_lock(pages[i]);
+		page_cache_release(pages[i]);
+	}
+
+	if (!ret) {
+		ret = len;
+		if (end_io)
+			end_io(iocb, offset, len, map_bh.b_private);
+	}
+	inode_dio_done(inode);
+	return ret;
+
+out_put_pages:
+	while (got > 0)
+		page_cache_release(pages[--got]);
+out_unlock:
+	inode_dio_done(inode);
+	if (rw == READ && (flags & DIO_LOCKING))
+		mutex_unlock(&inode->i_mutex);
+	return 0;
+}
+
 /*
  * This is a library function for use by filesystem drivers.
  *
@@ -1162,6 +1279,17 @@ do_blockdev_direct_IO(int rw, struct kiocb *iocb, struct inode *inode,
 	if (rw == READ && end == offset)
 		return 0;
 
+	if (nr_segs == 1 && blkbits == i_blkbits && !submit_io &&
+	    is_sync_kiocb(iocb) && end > offset &&
+	    (rw == READ || (flags & DIO_LOOKUP_ONLY))) {
+		retval = dio_simple_IO(rw, iocb, inode,
+				       (unsigned long)iov[0].iov_base,
+				       end - offset, offset, get_block,
+				       end_io, flags);
+		if (retval)
+			goto out;
+	}
+
 	dio = kmem_cache_alloc(dio_cache, GFP_KERNEL);
 	retval = -ENOMEM;
 	if (!dio)
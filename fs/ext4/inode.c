@@ -3163,7 +3163,9 @@ static ssize_t ext4_ext_direct_IO(int rw, struct kiocb *iocb,
 	}
 
 	if (overwrite) {
+		/* blocks are already allocated, get_block only looks them up */
 		get_block_func = ext4_get_block_write_nolock;
+		dio_flags = DIO_LOOKUP_ONLY;
 	} else {
 		get_block_func = ext4_get_block_write;
 		dio_flags = DIO_LOCKING;
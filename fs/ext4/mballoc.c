@@ -703,18 +703,40 @@ static void ext4_mb_mark_free_simple(struct super_block *sb,
 static void
 mb_set_largest_free_order(struct super_block *sb, struct ext4_group_info *grp)
 {
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	int old = grp->bb_largest_free_order;
+	int new = -1; /* uninit */
 	int i;
 	int bits;
 
-	grp->bb_largest_free_order = -1; /* uninit */
-
 	bits = sb->s_blocksize_bits + 1;
 	for (i = bits; i >= 0; i--) {
 		if (grp->bb_counters[i] > 0) {
-			grp->bb_largest_free_order = i;
+			new = i;
 			break;
 		}
 	}
+
+	/*
+	 * Keep the group on the index list matching its largest free
+	 * order, so that the allocator can find candidates without
+	 * walking every group.  Called with the group lock held.
+	 */
+	if (new == old && !list_empty(&grp->bb_largest_free_order_node))
+		return;
+
+	if (!list_empty(&grp->bb_largest_free_order_node)) {
+		write_lock(&sbi->s_mb_largest_free_orders_locks[old]);
+		list_del_init(&grp->bb_largest_free_order_node);
+		write_unlock(&sbi->s_mb_largest_free_orders_locks[old]);
+	}
+	grp->bb_largest_free_order = new;
+	if (new >= 0) {
+		write_lock(&sbi->s_mb_largest_free_orders_locks[new]);
+		list_add_tail(&grp->bb_largest_free_order_node,
+			      &sbi->s_mb_largest_free_orders[new]);
+		write_unlock(&sbi->s_mb_largest_free_orders_locks[new]);
+	}
 }
 
 static noinline_for_stack
@@ -1640,10 +1662,13 @@ static void ext4_mb_use_best_found(struct ext4_allocation_context *ac,
 	get_page(ac->ac_buddy_page);
 	/* store last allocated for subsequent stream allocation */
 	if (ac->ac_flags & EXT4_MB_STREAM_ALLOC) {
-		spin_lock(&sbi->s_md_lock);
-		sbi->s_mb_last_group = ac->ac_f_ex.fe_group;
-		sbi->s_mb_last_start = ac->ac_f_ex.fe_start;
-		spin_unlock(&sbi->s_md_lock);
+		struct ext4_mb_stream *stream;
+
+		/* only a hint, migrating to another cpu is harmless */
+		stream = per_cpu_ptr(sbi->s_mb_streams,
+				     raw_smp_processor_id());
+		ACCESS_ONCE(stream->group) = ac->ac_f_ex.fe_group;
+		ACCESS_ONCE(stream->start) = ac->ac_f_ex.fe_start;
 	}
 }
 
@@ -2061,10 +2086,151 @@ static int ext4_mb_good_group(struct ext4_allocation_context *ac,
 	return 0;
 }
 
+/*
+ * Check @group against criteria @cr and scan it if it looks suitable.
+ */
+static int ext4_mb_scan_group(struct ext4_allocation_context *ac,
+			      ext4_group_t group, int cr)
+{
+	struct super_block *sb = ac->ac_sb;
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	struct ext4_buddy e4b;
+	int err;
+
+	/* This now checks without needing the buddy page */
+	if (!ext4_mb_good_group(ac, group, cr))
+		return 0;
+
+	err = ext4_mb_load_buddy(sb, group, &e4b);
+	if (err)
+		return err;
+
+	ext4_lock_group(sb, group);
+
+	/*
+	 * We need to check again after locking the
+	 * block group
+	 */
+	if (!ext4_mb_good_group(ac, group, cr)) {
+		ext4_unlock_group(sb, group);
+		ext4_mb_unload_buddy(&e4b);
+		return 0;
+	}
+
+	ac->ac_groups_scanned++;
+	if (cr == 0 && ac->ac_2order < sb->s_blocksize_bits+2)
+		ext4_mb_simple_scan_group(ac, &e4b);
+	else if (cr == 1 && sbi->s_stripe &&
+			!(ac->ac_g_ex.fe_len % sbi->s_stripe))
+		ext4_mb_scan_aligned(ac, &e4b);
+	else
+		ext4_mb_complex_scan_group(ac, &e4b);
+
+	ext4_unlock_group(sb, group);
+	ext4_mb_unload_buddy(&e4b);
+	return 0;
+}
+
+/*
+ * Try the groups whose largest free extent is big enough for the request,
+ * taken from the largest-free-order index instead of walking every group.
+ * The index lists are only sampled under their read lock and groups whose
+ * lock is currently held by someone else are passed over, so that
+ * concurrent allocators spread out rather than queue up on the same group.
+ * Of the groups sampled, the ones closest after the goal are tried first,
+ * in the order the linear scan would reach them, so that the index doesn't
+ * throw away goal locality.  Groups tried here are recorded in @tried for
+ * the linear scan to skip; groups not found here are still reached by it.
+ */
+static noinline_for_stack int
+ext4_mb_scan_by_order(struct ext4_allocation_context *ac, int cr,
+		      ext4_group_t ngroups, ext4_group_t *tried, int *ntried)
+{
+	struct super_block *sb = ac->ac_sb;
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	ext4_group_t groups[MB_OPTIMIZE_SCAN_BATCH];
+	ext4_group_t dist[MB_OPTIMIZE_SCAN_BATCH];
+	ext4_group_t goal = ac->ac_g_ex.fe_group;
+	int max_order = sb->s_blocksize_bits + 1;
+	struct ext4_group_info *grp;
+	int order, n, i, j, seen, err;
+	ext4_group_t d;
+
+	if (cr == 0)
+		order = ac->ac_2order;
+	else
+		order = min(fls(ac->ac_g_ex.fe_len - 1), max_order);
+	if (order > max_order)
+		return 0;
+	if (goal >= ngroups)
+		goal = 0;
+
+	for (; order <= max_order; order++) {
+		n = 0;
+		seen = 0;
+		read_lock(&sbi->s_mb_largest_free_orders_locks[order]);
+		list_for_each_entry(grp, &sbi->s_mb_largest_free_orders[order],
+				    bb_largest_free_order_node) {
+			if (++seen > MB_OPTIMIZE_SCAN_SAMPLE)
+				break;
+			if (grp->bb_group >= ngroups ||
+			    grp->bb_free < ac->ac_g_ex.fe_len ||
+			    spin_is_locked(ext4_group_lock_ptr(sb,
+							grp->bb_group)))
+				continue;
+			/* keep the nearest ones, sorted by distance */
+			d = grp->bb_group >= goal ? grp->bb_group - goal :
+				grp->bb_group + ngroups - goal;
+			for (j = n; j > 0 && dist[j - 1] > d; j--) {
+				if (j < MB_OPTIMIZE_SCAN_BATCH) {
+					groups[j] = groups[j - 1];
+					dist[j] = dist[j - 1];
+				}
+			}
+			if (j < MB_OPTIMIZE_SCAN_BATCH) {
+				groups[j] = grp->bb_group;
+				dist[j] = d;
+				if (n < MB_OPTIMIZE_SCAN_BATCH)
+					n++;
+			}
+		}
+		read_unlock(&sbi->s_mb_largest_free_orders_locks[order]);
+
+		for (i = 0; i < n; i++) {
+			if (*ntried >= MB_OPTIMIZE_SCAN_MAX)
+				return 0;
+			tried[(*ntried)++] = groups[i];
+			cond_resched();
+			err = ext4_mb_scan_group(ac, groups[i], cr);
+			if (err)
+				return err;
+			if (ac->ac_status != AC_STATUS_CONTINUE) {
+				if (ac->ac_status == AC_STATUS_FOUND)
+					atomic_inc(&sbi->s_bal_opt_hits);
+				return 0;
+			}
+		}
+	}
+	return 0;
+}
+
+static bool ext4_mb_group_tried(ext4_group_t *tried, int ntried,
+				ext4_group_t group)
+{
+	int i;
+
+	for (i = 0; i < ntried; i++)
+		if (tried[i] == group)
+			return true;
+	return false;
+}
+
 static noinline_for_stack int
 ext4_mb_regular_allocator(struct ext4_allocation_context *ac)
 {
+	ext4_group_t tried[MB_OPTIMIZE_SCAN_MAX];
 	ext4_group_t ngroups, group, i;
+	int ntried;
 	int cr;
 	int err = 0;
 	struct ext4_sb_info *sbi;
@@ -2108,13 +2274,14 @@ ext4_mb_regular_allocator(struct ext4_allocation_context *ac)
 			ac->ac_2order = i - 1;
 	}
 
-	/* if stream allocation is enabled, use global goal */
+	/* if stream allocation is enabled, use this cpu's goal */
 	if (ac->ac_flags & EXT4_MB_STREAM_ALLOC) {
-		/* TBD: may be hot point */
-		spin_lock(&sbi->s_md_lock);
-		ac->ac_g_ex.fe_group = sbi->s_mb_last_group;
-		ac->ac_g_ex.fe_start = sbi->s_mb_last_start;
-		spin_unlock(&sbi->s_md_lock);
+		struct ext4_mb_stream *stream;
+
+		stream = per_cpu_ptr(sbi->s_mb_streams,
+				     raw_smp_processor_id());
+		ac->ac_g_ex.fe_group = ACCESS_ONCE(stream->group);
+		ac->ac_g_ex.fe_start = ACCESS_ONCE(stream->start);
 	}
 
 	/* Let's just scan groups to find more-less suitable blocks */
@@ -2126,6 +2293,17 @@ ext4_mb_regular_allocator(struct ext4_allocation_context *ac)
 repeat:
 	for (; cr < 4 && ac->ac_status == AC_STATUS_CONTINUE; cr++) {
 		ac->ac_criteria = cr;
+
+		ntried = 0;
+		if (cr < 2 && sbi->s_mb_optimize_scan) {
+			err = ext4_mb_scan_by_order(ac, cr, ngroups,
+						    tried, &ntried);
+			if (err)
+				goto out;
+			if (ac->ac_status != AC_STATUS_CONTINUE)
+				break;
+		}
+
 		/*
 		 * searching for the right group start
 		 * from the goal value specified
@@ -2141,38 +2319,14 @@ repeat:
 			if (group >= ngroups)
 				group = 0;
 
-			/* This now checks without needing the buddy page */
-			if (!ext4_mb_good_group(ac, group, cr))
+			/* already looked at through the order index */
+			if (ntried && ext4_mb_group_tried(tried, ntried, group))
 				continue;
 
-			err = ext4_mb_load_buddy(sb, group, &e4b);
+			err = ext4_mb_scan_group(ac, group, cr);
 			if (err)
 				goto out;
 
-			ext4_lock_group(sb, group);
-
-			/*
-			 * We need to check again after locking the
-			 * block group
-			 */
-			if (!ext4_mb_good_group(ac, group, cr)) {
-				ext4_unlock_group(sb, group);
-				ext4_mb_unload_buddy(&e4b);
-				continue;
-			}
-
-			ac->ac_groups_scanned++;
-			if (cr == 0 && ac->ac_2order < sb->s_blocksize_bits+2)
-				ext4_mb_simple_scan_group(ac, &e4b);
-			else if (cr == 1 && sbi->s_stripe &&
-					!(ac->ac_g_ex.fe_len % sbi->s_stripe))
-				ext4_mb_scan_aligned(ac, &e4b);
-			else
-				ext4_mb_complex_scan_group(ac, &e4b);
-
-			ext4_unlock_group(sb, group);
-			ext4_mb_unload_buddy(&e4b);
-
 			if (ac->ac_status != AC_STATUS_CONTINUE)
 				break;
 		}
@@ -2408,8 +2562,10 @@ int ext4_mb_add_groupinfo(struct super_block *sb, ext4_group_t group,
 	}
 
 	INIT_LIST_HEAD(&meta_group_info[i]->bb_prealloc_list);
+	INIT_LIST_HEAD(&meta_group_info[i]->bb_largest_free_order_node);
 	init_rwsem(&meta_group_info[i]->alloc_sem);
 	meta_group_info[i]->bb_free_root = RB_ROOT;
+	meta_group_info[i]->bb_group = group;
 	meta_group_info[i]->bb_largest_free_order = -1;  /* uninit */
 
 #ifdef DOUBLE_CHECK
@@ -2560,6 +2716,32 @@ int ext4_mb_init(struct super_block *sb)
 		goto out;
 	}
 
+	i = (sb->s_blocksize_bits + 2) *
+		sizeof(*sbi->s_mb_largest_free_orders);
+	sbi->s_mb_largest_free_orders = kmalloc(i, GFP_KERNEL);
+	if (sbi->s_mb_largest_free_orders == NULL) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	i = (sb->s_blocksize_bits + 2) *
+		sizeof(*sbi->s_mb_largest_free_orders_locks);
+	sbi->s_mb_largest_free_orders_locks = kmalloc(i, GFP_KERNEL);
+	if (sbi->s_mb_largest_free_orders_locks == NULL) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	for (i = 0; i < sb->s_blocksize_bits + 2; i++) {
+		INIT_LIST_HEAD(&sbi->s_mb_largest_free_orders[i]);
+		rwlock_init(&sbi->s_mb_largest_free_orders_locks[i]);
+	}
+
+	sbi->s_mb_streams = alloc_percpu(struct ext4_mb_stream);
+	if (sbi->s_mb_streams == NULL) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
 	ret = ext4_groupinfo_create_slab(sb->s_blocksize);
 	if (ret < 0)
 		goto out;
@@ -2587,6 +2769,12 @@ int ext4_mb_init(struct super_block *sb)
 	sbi->s_mb_stats = MB_DEFAULT_STATS;
 	sbi->s_mb_stream_request = MB_DEFAULT_STREAM_THRESHOLD;
 	sbi->s_mb_order2_reqs = MB_DEFAULT_ORDER2_REQS;
+	/*
+	 * The index gives up some goal locality to find a group quickly,
+	 * which is a bad trade when the extra distance costs seeks.
+	 */
+	sbi->s_mb_optimize_scan = MB_DEFAULT_OPTIMIZE_SCAN &&
+		blk_queue_nonrot(bdev_get_queue(sb->s_bdev));
 	/*
 	 * The default group preallocation is 512, which for 4k block
 	 * sizes translates to 2 megabytes.  However for bigalloc file
@@ -2645,6 +2833,12 @@ out_free_locality_groups:
 out_free_groupinfo_slab:
 	ext4_groupinfo_destroy_slabs();
 out:
+	free_percpu(sbi->s_mb_streams);
+	sbi->s_mb_streams = NULL;
+	kfree(sbi->s_mb_largest_free_orders);
+	sbi->s_mb_largest_free_orders = NULL;
+	kfree(sbi->s_mb_largest_free_orders_locks);
+	sbi->s_mb_largest_free_orders_locks = NULL;
 	kfree(sbi->s_mb_offsets);
 	sbi->s_mb_offsets = NULL;
 	kfree(sbi->s_mb_maxs);
@@ -2702,6 +2896,8 @@ int ext4_mb_release(struct super_block *sb)
 	}
 	kfree(sbi->s_mb_offsets);
 	kfree(sbi->s_mb_maxs);
+	kfree(sbi->s_mb_largest_free_orders);
+	kfree(sbi->s_mb_largest_free_orders_locks);
 	if (sbi->s_buddy_cache)
 		iput(sbi->s_buddy_cache);
 	if (sbi->s_mb_stats) {
@@ -2718,6 +2914,9 @@ int ext4_mb_release(struct super_block *sb)
 				atomic_read(&sbi->s_bal_2orders),
 				atomic_read(&sbi->s_bal_breaks),
 				atomic_read(&sbi->s_mb_lost_chunks));
+		ext4_msg(sb, KERN_INFO,
+		       "mballoc: %u allocations from the order index",
+				atomic_read(&sbi->s_bal_opt_hits));
 		ext4_msg(sb, KERN_INFO,
 		       "mballoc: %lu generated and it took %Lu",
 				sbi->s_mb_buddies_generated,
@@ -2729,6 +2928,7 @@ int ext4_mb_release(struct super_block *sb)
 	}
 
 	free_percpu(sbi->s_locality_groups);
+	free_percpu(sbi->s_mb_streams);
 
 	return 0;
 }
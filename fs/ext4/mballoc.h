@@ -89,6 +89,28 @@ extern ushort ext4_mballoc_debug;
  */
 #define MB_DEFAULT_GROUP_PREALLOC	512
 
+/*
+ * pick cr 0/1 candidates from the largest-free-order index
+ * instead of walking all groups, tunable via mb_optimize_scan;
+ * only enabled by default on non-rotational devices
+ */
+#define MB_DEFAULT_OPTIMIZE_SCAN	1
+
+/*
+ * max groups taken from one order list per pass
+ */
+#define MB_OPTIMIZE_SCAN_BATCH		8
+
+/*
+ * max list entries looked at per order for the ones nearest the goal
+ */
+#define MB_OPTIMIZE_SCAN_SAMPLE		64
+
+/*
+ * max groups tried through the index per criteria
+ */
+#define MB_OPTIMIZE_SCAN_MAX		32
+
 
 struct ext4_free_data {
 	/* MUST be the first member */
@@ -32,6 +32,7 @@ static int gc_thread_func(void *data)
 	struct f2fs_gc_kthread *gc_th = sbi->gc_thread;
 	wait_queue_head_t *wq = &sbi->gc_thread->gc_wait_queue_head;
 	long wait_ms;
+	bool urgent;
 
 	wait_ms = gc_th->min_sleep_time;
 
@@ -40,11 +41,14 @@ static int gc_thread_func(void *data)
 			continue;
 		else
 			wait_event_interruptible_timeout(*wq,
-						kthread_should_stop(),
-						msecs_to_jiffies(wait_ms));
+					kthread_should_stop() ||
+					test_bit(GC_THREAD_WAKE, &gc_th->gc_flags),
+					msecs_to_jiffies(wait_ms));
 		if (kthread_should_stop())
 			break;
 
+		clear_bit(GC_THREAD_WAKE, &gc_th->gc_flags);
+
 		if (sbi->sb->s_writers.frozen >= SB_FREEZE_WRITE) {
 			wait_ms = increase_sleep_time(gc_th, wait_ms);
 			continue;
@@ -66,13 +70,24 @@ static int gc_thread_func(void *data)
 		if (!mutex_trylock(&sbi->gc_mutex))
 			continue;
 
-		if (!is_idle(sbi)) {
+		/*
+		 * 4. Or the free section reserve is running low, in which
+		 *    case we don't wait for the device to go idle: doing
+		 *    the work now keeps writers out of foreground GC.  Not
+		 *    while backing off after finding no victim, though.
+		 */
+		urgent = gc_reserve_low(sbi) &&
+			!time_before(jiffies, gc_th->nogc_until);
+
+		if (!urgent && !is_idle(sbi)) {
 			wait_ms = increase_sleep_time(gc_th, wait_ms);
 			mutex_unlock(&sbi->gc_mutex);
 			continue;
 		}
 
-		if (has_enough_invalid_blocks(sbi))
+		if (urgent)
+			wait_ms = DEF_GC_THREAD_URGENT_SLEEP_TIME;
+		else if (has_enough_invalid_blocks(sbi))
 			wait_ms = decrease_sleep_time(gc_th, wait_ms);
 		else
 			wait_ms = increase_sleep_time(gc_th, wait_ms);
@@ -80,11 +95,29 @@ static int gc_thread_func(void *data)
 		stat_inc_bggc_count(sbi);
 
 		/* if return value is not zero, no victim was selected */
-		if (f2fs_gc(sbi))
+		if (f2fs_gc(sbi)) {
 			wait_ms = gc_th->no_gc_sleep_time;
+			gc_th->nogc_until = jiffies + msecs_to_jiffies(wait_ms);
+		}
 
-		/* balancing f2fs's metadata periodically */
-		f2fs_balance_fs_bg(sbi);
+		/*
+		 * Sections cleaned by background GC only become free at the
+		 * next checkpoint.  When refilling the reserve, write that
+		 * checkpoint from here rather than leaving it to a writer, but
+		 * only once a reserve's worth of sections is waiting for it and
+		 * not more often than every DEF_GC_THREAD_CP_INTERVAL: it
+		 * blocks all writers while it runs.
+		 */
+		if (urgent && prefree_segments(sbi) >=
+				SM_I(sbi)->gc_reserve_secs * sbi->segs_per_sec &&
+				time_after_eq(jiffies, gc_th->last_cp +
+				msecs_to_jiffies(DEF_GC_THREAD_CP_INTERVAL))) {
+			gc_th->last_cp = jiffies;
+			f2fs_sync_fs(sbi->sb, true);
+		} else {
+			/* balancing f2fs's metadata periodically */
+			f2fs_balance_fs_bg(sbi);
+		}
 
 	} while (!kthread_should_stop());
 	return 0;
@@ -109,6 +142,9 @@ int start_gc_thread(struct f2fs_sb_info *sbi)
 	gc_th->no_gc_sleep_time = DEF_GC_THREAD_NOGC_SLEEP_TIME;
 
 	gc_th->gc_idle = 0;
+	gc_th->gc_flags = 0;
+	gc_th->nogc_until = jiffies;
+	gc_th->last_cp = jiffies;
 
 	sbi->gc_thread = gc_th;
 	init_waitqueue_head(&sbi->gc_thread->gc_wait_queue_head);
@@ -123,6 +159,16 @@ out:
 	return err;
 }
 
+void f2fs_wake_gc_thread(struct f2fs_sb_info *sbi)
+{
+	struct f2fs_gc_kthread *gc_th = sbi->gc_thread;
+
+	if (!gc_th || time_before(jiffies, gc_th->nogc_until))
+		return;
+	if (!test_and_set_bit(GC_THREAD_WAKE, &gc_th->gc_flags))
+		wake_up_interruptible_all(&gc_th->gc_wait_queue_head);
+}
+
 void stop_gc_thread(struct f2fs_sb_info *sbi)
 {
 	struct f2fs_gc_kthread *gc_th = sbi->gc_thread;
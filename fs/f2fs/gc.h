@@ -16,6 +16,8 @@
 #define DEF_GC_THREAD_MIN_SLEEP_TIME	30000	/* milliseconds */
 #define DEF_GC_THREAD_MAX_SLEEP_TIME	60000
 #define DEF_GC_THREAD_NOGC_SLEEP_TIME	300000	/* wait 5 min */
+#define DEF_GC_THREAD_URGENT_SLEEP_TIME	100	/* while refilling the reserve */
+#define DEF_GC_THREAD_CP_INTERVAL	1000	/* min. gap between its checkpoints */
 #define LIMIT_INVALID_BLOCK	40 /* percentage over total user space */
 #define LIMIT_FREE_BLOCK	40 /* percentage over invalid + free space */
 
@@ -33,8 +35,16 @@ struct f2fs_gc_kthread {
 
 	/* for changing gc mode */
 	unsigned int gc_idle;
+
+	/* for refilling the free section reserve */
+	unsigned long gc_flags;		/* GC_THREAD_WAKE */
+	unsigned long nogc_until;	/* no victim found, back off until then */
+	unsigned long last_cp;		/* jiffies of our last checkpoint */
 };
 
+/* gc_flags: set by writers that see the free section reserve running low */
+#define GC_THREAD_WAKE		0
+
 struct inode_entry {
 	struct list_head list;
 	struct inode *inode;
@@ -186,6 +186,9 @@ void f2fs_balance_fs(struct f2fs_sb_info *sbi)
 	if (has_not_enough_free_secs(sbi, 0)) {
 		mutex_lock(&sbi->gc_mutex);
 		f2fs_gc(sbi);
+	} else if (gc_reserve_low(sbi)) {
+		/* let the GC thread refill the reserve before we run dry */
+		f2fs_wake_gc_thread(sbi);
 	}
 }
 
@@ -1855,6 +1858,7 @@ int build_segment_manager(struct f2fs_sb_info *sbi)
 					DEF_RECLAIM_PREFREE_SEGMENTS / 100;
 	sm_info->ipu_policy = F2FS_IPU_DISABLE;
 	sm_info->min_ipu_util = DEF_MIN_IPU_UTIL;
+	sm_info->gc_reserve_secs = DEF_GC_RESERVE_SECTIONS;
 
 	INIT_LIST_HEAD(&sm_info->discard_list);
 	sm_info->nr_discards = 0;
@@ -446,6 +446,24 @@ static inline bool has_not_enough_free_secs(struct f2fs_sb_info *sbi, int freed)
 						reserved_sections(sbi));
 }
 
+/*
+ * Background GC tries to keep gc_reserve_secs free sections on top of what
+ * has_not_enough_free_secs() needs, so that writers don't have to fall into
+ * foreground GC.
+ */
+static inline bool gc_reserve_low(struct f2fs_sb_info *sbi)
+{
+	int node_secs = get_blocktype_secs(sbi, F2FS_DIRTY_NODES);
+	int dent_secs = get_blocktype_secs(sbi, F2FS_DIRTY_DENTS);
+
+	if (unlikely(sbi->por_doing))
+		return false;
+
+	/* add the reserve on this side: free_sections() is unsigned */
+	return free_sections(sbi) <= node_secs + 2 * dent_secs +
+			reserved_sections(sbi) + SM_I(sbi)->gc_reserve_secs;
+}
+
 static inline bool excess_prefree_segs(struct f2fs_sb_info *sbi)
 {
 	return prefree_segments(sbi) > SM_I(sbi)->rec_prefree_segments;
@@ -470,6 +488,8 @@ static inline int utilization(struct f2fs_sb_info *sbi)
  */
 #define DEF_MIN_IPU_UTIL	70
 
+#define DEF_GC_RESERVE_SECTIONS	4
+
 enum {
 	F2FS_IPU_FORCE,
 	F2FS_IPU_SSR,
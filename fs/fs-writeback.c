@@ -34,6 +34,12 @@
  */
 #define MIN_WRITEBACK_PAGES	(4096UL >> (PAGE_CACHE_SHIFT - 10))
 
+/*
+ * Number of flushers working on a bdi's b_io list at the same time for
+ * background and periodic writeback. Exported to sysctl.
+ */
+int dirty_writeback_workers = 1;
+
 /*
  * Passed into wb_writeback(), essentially a subset of writeback_control
  */
@@ -744,6 +750,100 @@ static long __writeback_inodes_wb(struct bdi_writeback *wb,
 	return wrote;
 }
 
+/*
+ * A helper flusher running __writeback_inodes_wb() on its share of a
+ * WB_SYNC_NONE work item, next to the flusher that owns the item.
+ */
+struct wb_writeback_helper {
+	struct work_struct work;
+	struct bdi_writeback *wb;
+	struct wb_writeback_work wb_work;
+	long wrote;
+};
+
+static void wb_writeback_helper_fn(struct work_struct *work)
+{
+	struct wb_writeback_helper *helper =
+		container_of(work, struct wb_writeback_helper, work);
+	struct bdi_writeback *wb = helper->wb;
+
+	spin_lock(&wb->list_lock);
+	helper->wrote = __writeback_inodes_wb(wb, &helper->wb_work);
+	spin_unlock(&wb->list_lock);
+}
+
+/*
+ * Like __writeback_inodes_wb(), but split @work between up to
+ * dirty_writeback_workers flushers pulling inodes off the same b_io list,
+ * so that a fast device is not limited to what one thread can push out.
+ *
+ * Inodes are handed out one at a time under wb->list_lock and pinned with
+ * I_SYNC while being written, so two flushers never write the same inode;
+ * one that finds an inode busy moves it to b_more_io as usual.
+ *
+ * Called with wb->list_lock held, which may be dropped and retaken.
+ */
+static long writeback_inodes_wb_parallel(struct bdi_writeback *wb,
+					 struct wb_writeback_work *work)
+{
+	struct wb_writeback_helper *helpers;
+	int nr = min_t(int, ACCESS_ONCE(dirty_writeback_workers),
+		       WB_MAX_WORKERS);
+	long total = work->nr_pages;
+	long share, wrote;
+	int i;
+
+	/*
+	 * Data integrity writeback relies on a single pass over b_io for
+	 * livelock avoidance, and one inode is not worth waking anyone for.
+	 */
+	if (nr <= 1 || work->sync_mode == WB_SYNC_ALL ||
+	    work->tagged_writepages || wb->b_io.next == wb->b_io.prev)
+		return __writeback_inodes_wb(wb, work);
+
+	share = total / nr;
+	if (share < (long)MIN_WRITEBACK_PAGES)
+		return __writeback_inodes_wb(wb, work);
+
+	helpers = kcalloc(nr - 1, sizeof(*helpers), GFP_NOWAIT | __GFP_NOWARN);
+	if (!helpers)
+		return __writeback_inodes_wb(wb, work);
+
+	for (i = 0; i < nr - 1; i++) {
+		struct wb_writeback_helper *helper = &helpers[i];
+
+		INIT_WORK(&helper->work, wb_writeback_helper_fn);
+		helper->wb = wb;
+		helper->wb_work = *work;
+		helper->wb_work.nr_pages = share;
+		helper->wb_work.done = NULL;
+		INIT_LIST_HEAD(&helper->wb_work.list);
+		queue_work(bdi_wq, &helper->work);
+	}
+
+	work->nr_pages = share;
+	wrote = __writeback_inodes_wb(wb, work);
+	total -= share - work->nr_pages;
+
+	/*
+	 * We are running on bdi_wq ourselves.  Under memory pressure only its
+	 * rescuer may be running, so a helper that hasn't started yet might
+	 * never start behind us: take it back and do its share here instead.
+	 */
+	spin_unlock(&wb->list_lock);
+	for (i = 0; i < nr - 1; i++) {
+		if (cancel_work_sync(&helpers[i].work))
+			wb_writeback_helper_fn(&helpers[i].work);
+		wrote += helpers[i].wrote;
+		total -= share - helpers[i].wb_work.nr_pages;
+	}
+	spin_lock(&wb->list_lock);
+
+	kfree(helpers);
+	work->nr_pages = total;
+	return wrote;
+}
+
 static long writeback_inodes_wb(struct bdi_writeback *wb, long nr_pages,
 				enum wb_reason reason)
 {
@@ -860,7 +960,7 @@ static long wb_writeback(struct bdi_writeback *wb,
 		if (work->sb)
 			progress = writeback_sb_inodes(work->sb, wb, work);
 		else
-			progress = __writeback_inodes_wb(wb, work);
+			progress = writeback_inodes_wb_parallel(wb, work);
 		trace_writeback_written(wb->bdi, work);
 
 		wb_update_bandwidth(wb, wb_start);
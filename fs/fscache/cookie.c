@@ -113,6 +113,12 @@ struct fscache_cookie *__fscache_acquire_cookie(
 	 * told it may not wait */
 	INIT_RADIX_TREE(&cookie->stores, GFP_NOFS & ~__GFP_WAIT);
 
+#ifdef CONFIG_FSCACHE_STATS
+	/* the slab constructor only clears these the first time round */
+	memset(&cookie->retrieval_lat, 0, sizeof(cookie->retrieval_lat));
+	memset(&cookie->store_lat, 0, sizeof(cookie->store_lat));
+#endif
+
 	switch (cookie->def->type) {
 	case FSCACHE_COOKIE_TYPE_INDEX:
 		fscache_stat(&fscache_n_cookie_index);
@@ -27,6 +27,7 @@
 
 #define FSCACHE_MIN_THREADS	4
 #define FSCACHE_MAX_THREADS	32
+#define FSCACHE_STORE_BATCH	16	/* pages stored per write op dispatch */
 
 /*
  * cache.c
@@ -279,12 +280,30 @@ static inline void fscache_stat_d(atomic_t *stat)
 
 #define __fscache_stat(stat) (stat)
 
+/*
+ * note the latency of an I/O event against a cookie
+ * - the maximum is updated racily; it's only a statistic
+ */
+static inline void fscache_stat_latency(struct fscache_cookie_latency *lat,
+					ktime_t start)
+{
+	s64 us = ktime_us_delta(ktime_get(), start);
+
+	if (us < 0)
+		us = 0;
+	atomic_inc(&lat->nr);
+	atomic64_add(us, &lat->total_us);
+	if (us > ACCESS_ONCE(lat->max_us))
+		lat->max_us = us;
+}
+
 extern const struct file_operations fscache_stats_fops;
 #else
 
 #define __fscache_stat(stat) (NULL)
 #define fscache_stat(stat) do {} while (0)
 #define fscache_stat_d(stat) do {} while (0)
+#define fscache_stat_latency(lat, start) do {} while (0)
 #endif
 
 /*
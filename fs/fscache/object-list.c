@@ -36,6 +36,7 @@ struct fscache_objlist_data {
 #define FSCACHE_OBJLIST_CONFIG_NOEVENTS	0x00000800	/* show objects without no events */
 #define FSCACHE_OBJLIST_CONFIG_WORK	0x00001000	/* show objects with work */
 #define FSCACHE_OBJLIST_CONFIG_NOWORK	0x00002000	/* show objects without work */
+#define FSCACHE_OBJLIST_CONFIG_LATENCY	0x00004000	/* show cookie I/O latencies */
 
 	u8		buf[512];	/* key and aux data buffer */
 };
@@ -160,6 +161,25 @@ static void fscache_objlist_stop(struct seq_file *m, void *v)
 	read_unlock(&fscache_object_list_lock);
 }
 
+#ifdef CONFIG_FSCACHE_STATS
+/*
+ * display the I/O latency record of a cookie as count, mean and max in uS
+ */
+static void fscache_objlist_show_latency(struct seq_file *m,
+					 struct fscache_cookie_latency *lat)
+{
+	unsigned nr = atomic_read(&lat->nr);
+	u64 avg = 0;
+
+	if (nr) {
+		avg = atomic64_read(&lat->total_us);
+		do_div(avg, nr);
+	}
+	seq_printf(m, " %6u %8llu %8lu",
+		   nr, (unsigned long long) avg, ACCESS_ONCE(lat->max_us));
+}
+#endif
+
 /*
  * display an object
  */
@@ -176,9 +196,16 @@ static int fscache_objlist_show(struct seq_file *m, void *v)
 		seq_puts(m, "OBJECT   PARENT   STAT CHLDN OPS OOP IPR EX READS"
 			 " EM EV FL S"
 			 " | NETFS_COOKIE_DEF TY FL NETFS_DATA");
+#ifdef CONFIG_FSCACHE_STATS
+		if (config & FSCACHE_OBJLIST_CONFIG_LATENCY)
+			seq_puts(m, "      "
+				 "  RD_NR   RD_AVG   RD_MAX"
+				 "  WR_NR   WR_AVG   WR_MAX");
+#endif
 		if (config & (FSCACHE_OBJLIST_CONFIG_KEY |
 			      FSCACHE_OBJLIST_CONFIG_AUX))
-			seq_puts(m, "       ");
+			seq_puts(m, config & FSCACHE_OBJLIST_CONFIG_LATENCY ?
+				 " " : "       ");
 		if (config & FSCACHE_OBJLIST_CONFIG_KEY)
 			seq_puts(m, "OBJECT_KEY");
 		if ((config & (FSCACHE_OBJLIST_CONFIG_KEY |
@@ -195,6 +222,11 @@ static int fscache_objlist_show(struct seq_file *m, void *v)
 		seq_puts(m, "======== ======== ==== ===== === === === == ====="
 			 " == == == ="
 			 " | ================ == == ================");
+#ifdef CONFIG_FSCACHE_STATS
+		if (config & FSCACHE_OBJLIST_CONFIG_LATENCY)
+			seq_puts(m, " ====== ======== ========"
+				 " ====== ======== ========");
+#endif
 		if (config & (FSCACHE_OBJLIST_CONFIG_KEY |
 			      FSCACHE_OBJLIST_CONFIG_AUX))
 			seq_puts(m, " ================");
@@ -273,6 +305,13 @@ static int fscache_objlist_show(struct seq_file *m, void *v)
 			   cookie->flags,
 			   cookie->netfs_data);
 
+#ifdef CONFIG_FSCACHE_STATS
+		if (config & FSCACHE_OBJLIST_CONFIG_LATENCY) {
+			fscache_objlist_show_latency(m, &cookie->retrieval_lat);
+			fscache_objlist_show_latency(m, &cookie->store_lat);
+		}
+#endif
+
 		if (cookie->def->get_key &&
 		    config & FSCACHE_OBJLIST_CONFIG_KEY)
 			keylen = cookie->def->get_key(cookie->netfs_data,
@@ -346,6 +385,9 @@ static void fscache_objlist_config(struct fscache_objlist_data *data)
 		case 'r': config |= FSCACHE_OBJLIST_CONFIG_NOREADS;	break;
 		case 'S': config |= FSCACHE_OBJLIST_CONFIG_WORK;	break;
 		case 's': config |= FSCACHE_OBJLIST_CONFIG_NOWORK;	break;
+#ifdef CONFIG_FSCACHE_STATS
+		case 'L': config |= FSCACHE_OBJLIST_CONFIG_LATENCY;	break;
+#endif
 		}
 	}
 
@@ -370,7 +412,8 @@ static void fscache_objlist_config(struct fscache_objlist_data *data)
 
 no_config:
 #endif
-	data->config = ULONG_MAX;
+	/* latencies add columns, so they're only shown on request */
+	data->config = ULONG_MAX & ~FSCACHE_OBJLIST_CONFIG_LATENCY;
 }
 
 /*
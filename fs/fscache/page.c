@@ -244,6 +244,11 @@ static void fscache_release_retrieval_op(struct fscache_operation *_op)
 	ASSERTCMP(atomic_read(&op->n_pages), ==, 0);
 
 	fscache_hist(fscache_retrieval_histogram, op->start_time);
+#ifdef CONFIG_FSCACHE_STATS
+	if (op->op.object && op->op.object->cookie)
+		fscache_stat_latency(&op->op.object->cookie->retrieval_lat,
+				     op->start_ktime);
+#endif
 	if (op->context)
 		fscache_put_context(op->op.object->cookie, op->context);
 
@@ -276,6 +281,9 @@ static struct fscache_retrieval *fscache_alloc_retrieval(
 	op->end_io_func	= end_io_func;
 	op->context	= context;
 	op->start_time	= jiffies;
+#ifdef CONFIG_FSCACHE_STATS
+	op->start_ktime	= ktime_get();
+#endif
 	INIT_LIST_HEAD(&op->to_do);
 	return op;
 }
@@ -755,12 +763,16 @@ static void fscache_write_op(struct fscache_operation *_op)
 	struct fscache_object *object = op->op.object;
 	struct fscache_cookie *cookie;
 	struct page *page;
-	unsigned n;
+	unsigned n, batch = 0;
 	void *results[1];
+#ifdef CONFIG_FSCACHE_STATS
+	ktime_t start;
+#endif
 	int ret;
 
 	_enter("{OP%x,%d}", op->op.debug_id, atomic_read(&op->op.usage));
 
+next_page:
 	spin_lock(&object->lock);
 	cookie = object->cookie;
 
@@ -816,16 +828,28 @@ static void fscache_write_op(struct fscache_operation *_op)
 
 	fscache_stat(&fscache_n_store_pages);
 	fscache_stat(&fscache_n_cop_write_page);
+#ifdef CONFIG_FSCACHE_STATS
+	start = ktime_get();
+#endif
 	ret = object->cache->ops->write_page(op, page);
 	fscache_stat_d(&fscache_n_cop_write_page);
+	fscache_stat_latency(&cookie->store_lat, start);
 	fscache_end_page_write(object, page);
 	if (ret < 0) {
 		fscache_abort_object(object);
 		fscache_op_complete(&op->op, true);
-	} else {
-		fscache_enqueue_operation(&op->op);
+		_leave("");
+		return;
 	}
 
+	/* store a batch of pages before yielding the thread so that the
+	 * backend sees a run of adjacent writes rather than one page per
+	 * dispatch */
+	if (++batch < FSCACHE_STORE_BATCH && !need_resched())
+		goto next_page;
+
+	fscache_enqueue_operation(&op->op);
+
 	_leave("");
 	return;
 
@@ -27,6 +27,7 @@
 #include <linux/bio.h>
 #include <linux/blkdev.h>
 #include <linux/bitops.h>
+#include <linux/workqueue.h>
 #include <trace/events/jbd2.h>
 
 /*
@@ -358,6 +359,118 @@ static void jbd2_block_tag_csum_set(journal_t *j, journal_block_tag_t *tag,
 	/* We only have space to store the lower 16 bits of the crc32c. */
 	tag->t_checksum = cpu_to_be16(csum32);
 }
+
+/*
+ * A descriptor block holds its tags back to back, except that the first
+ * one is followed by the journal uuid.
+ */
+static journal_block_tag_t *jbd2_descr_tag(struct buffer_head *descriptor,
+					   int i, int tag_bytes)
+{
+	char *p = descriptor->b_data + sizeof(journal_header_t);
+
+	p += i * tag_bytes;
+	if (i)
+		p += 16;
+	return (journal_block_tag_t *)p;
+}
+
+/*
+ * Checksumming a full descriptor's worth of blocks is a few hundred crc32c
+ * passes over whole blocks, done while the disk sits idle.  Batches at
+ * least this large are split across CPUs.
+ */
+#define JBD2_PARALLEL_CSUM_MIN		64
+#define JBD2_PARALLEL_CSUM_WORKERS	4
+
+/*
+ * The commit thread waits on these work items, and reclaim may be waiting
+ * on the commit, so they need a WQ_MEM_RECLAIM workqueue of their own.
+ * Set up in journal_init(); without it everything is done inline.
+ */
+static struct workqueue_struct *jbd2_csum_wq;
+
+void jbd2_journal_init_csum_wq(void)
+{
+	jbd2_csum_wq = alloc_workqueue("jbd2-csum",
+				       WQ_MEM_RECLAIM | WQ_UNBOUND, 0);
+}
+
+void jbd2_journal_destroy_csum_wq(void)
+{
+	if (jbd2_csum_wq) {
+		destroy_workqueue(jbd2_csum_wq);
+		jbd2_csum_wq = NULL;
+	}
+}
+
+struct jbd2_csum_work {
+	struct work_struct	work;
+	journal_t		*journal;
+	struct buffer_head	*descriptor;
+	struct buffer_head	**bhs;
+	int			first, nr;
+	int			tag_bytes;
+	__u32			sequence;
+};
+
+static void __jbd2_block_tags_csum_set(struct jbd2_csum_work *cw)
+{
+	int i;
+
+	for (i = cw->first; i < cw->first + cw->nr; i++)
+		jbd2_block_tag_csum_set(cw->journal,
+				jbd2_descr_tag(cw->descriptor, i, cw->tag_bytes),
+				cw->bhs[i], cw->sequence);
+}
+
+static void jbd2_block_tags_csum_work(struct work_struct *work)
+{
+	__jbd2_block_tags_csum_set(container_of(work, struct jbd2_csum_work,
+						work));
+}
+
+/*
+ * Set the tag checksums for the @nr buffers described by @descriptor.  This
+ * must happen before the descriptor block itself is checksummed.
+ */
+static noinline void jbd2_block_tags_csum_set(journal_t *journal,
+		struct buffer_head *descriptor, struct buffer_head **bhs,
+		int nr, int tag_bytes, __u32 sequence)
+{
+	struct jbd2_csum_work cw[JBD2_PARALLEL_CSUM_WORKERS];
+	int workers = 1, chunk, i;
+
+	if (!JBD2_HAS_INCOMPAT_FEATURE(journal, JBD2_FEATURE_INCOMPAT_CSUM_V2))
+		return;
+
+	if (jbd2_csum_wq && nr >= JBD2_PARALLEL_CSUM_MIN)
+		workers = min3(num_online_cpus(),
+			       (unsigned int)JBD2_PARALLEL_CSUM_WORKERS,
+			       (unsigned int)(nr / (JBD2_PARALLEL_CSUM_MIN / 2)));
+	chunk = DIV_ROUND_UP(nr, workers);
+
+	for (i = 0; i < workers; i++) {
+		cw[i].journal = journal;
+		cw[i].descriptor = descriptor;
+		cw[i].bhs = bhs;
+		cw[i].first = i * chunk;
+		cw[i].nr = min(chunk, nr - cw[i].first);
+		cw[i].tag_bytes = tag_bytes;
+		cw[i].sequence = sequence;
+	}
+
+	/* hand out all but the first chunk, which we do ourselves */
+	for (i = 1; i < workers; i++) {
+		INIT_WORK_ONSTACK(&cw[i].work, jbd2_block_tags_csum_work);
+		queue_work(jbd2_csum_wq, &cw[i].work);
+	}
+	__jbd2_block_tags_csum_set(&cw[0]);
+	for (i = 1; i < workers; i++) {
+		flush_work(&cw[i].work);
+		destroy_work_on_stack(&cw[i].work);
+	}
+}
 /*
  * jbd2_journal_commit_transaction
  *
@@ -692,8 +805,6 @@ void jbd2_journal_commit_transaction(journal_t *journal)
 		tag = (journal_block_tag_t *) tagp;
 		write_tag_block(tag_bytes, tag, jh2bh(jh)->b_blocknr);
 		tag->t_flags = cpu_to_be16(tag_flag);
-		jbd2_block_tag_csum_set(journal, tag, wbuf[bufs],
-					commit_transaction->t_tid);
 		tagp += tag_bytes;
 		space_left -= tag_bytes;
 		bufs++;
@@ -720,6 +831,10 @@ void jbd2_journal_commit_transaction(journal_t *journal)
 
 			tag->t_flags |= cpu_to_be16(JBD2_FLAG_LAST_TAG);
 
+			/* wbuf[0] is the descriptor itself */
+			jbd2_block_tags_csum_set(journal, descriptor, wbuf + 1,
+						 bufs - 1, tag_bytes,
+						 commit_transaction->t_tid);
 			jbd2_descr_block_csum_set(journal, descriptor);
 start_journal_io:
 			for (i = 0; i < bufs; i++) {
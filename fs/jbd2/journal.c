@@ -43,6 +43,7 @@
 #include <linux/backing-dev.h>
 #include <linux/bitops.h>
 #include <linux/ratelimit.h>
+#include <linux/workqueue.h>
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/jbd2.h>
@@ -2632,6 +2633,7 @@ static int __init journal_init(void)
 	ret = journal_init_caches();
 	if (ret == 0) {
 		jbd2_create_jbd_stats_proc_entry();
+		jbd2_journal_init_csum_wq();
 	} else {
 		jbd2_journal_destroy_caches();
 	}
@@ -2645,6 +2647,7 @@ static void __exit journal_exit(void)
 	if (n)
 		printk(KERN_ERR "JBD2: leaked %d journal_heads!\n", n);
 #endif
+	jbd2_journal_destroy_csum_wq();
 	jbd2_remove_jbd_stats_proc_entry();
 	jbd2_journal_destroy_caches();
 }
@@ -0,0 +1,533 @@
+/*
+ * JFFS2 -- Journalling Flash File System, Version 2.
+ *
+ * Copyright © 2001-2007 Red Hat, Inc.
+ *
+ * For licensing information, see the file 'LICENCE' in this directory.
+ *
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/sched.h>
+#include <linux/completion.h>
+#include <linux/mtd/mtd.h>
+#include <linux/crc32.h>
+#include "nodelist.h"
+#include "summary.h"
+#include "checkpoint.h"
+#include "debug.h"
+
+/*
+ * A checkpoint is one eraseblock which records, for every other block,
+ * whether it is free, bad, or full with a summary node (a copy of which
+ * is kept in the checkpoint). Mounting with -o checkpoint then only has
+ * to read that one block plus whatever the checkpoint couldn't describe,
+ * instead of visiting every eraseblock on the flash.
+ *
+ * The checkpoint is only correct for as long as nothing is written or
+ * erased. It is written when the file system goes read-only (at unmount
+ * or remount), and destroyed when it next goes read-write, before the
+ * garbage collector starts. So the block is erased once per read-write
+ * mount, and never from the allocation path.
+ */
+
+struct jffs2_checkpoint_image {
+	struct jffs2_raw_checkpoint *node;
+	uint32_t next;		/* index of the block we expect next */
+	uint32_t pos;		/* offset of the next summary copy */
+};
+
+/* The checkpoint always goes into the first good eraseblock, so that mount
+   can find it without looking anywhere else. */
+static struct jffs2_eraseblock *jffs2_checkpoint_target(struct jffs2_sb_info *c)
+{
+	uint32_t i;
+
+	for (i = 0; i < c->nr_blocks; i++) {
+		if (!mtd_can_have_bb(c->mtd) ||
+		    !mtd_block_isbad(c->mtd, c->blocks[i].offset))
+			return &c->blocks[i];
+	}
+	return NULL;
+}
+
+static void jffs2_checkpoint_erase_callback(struct erase_info *instr)
+{
+	complete((struct completion *)instr->priv);
+}
+
+static int jffs2_checkpoint_erase(struct jffs2_sb_info *c,
+				  struct jffs2_eraseblock *jeb)
+{
+	DECLARE_COMPLETION_ONSTACK(done);
+	struct erase_info instr;
+	int ret;
+
+	memset(&instr, 0, sizeof(instr));
+	instr.mtd = c->mtd;
+	instr.addr = jeb->offset;
+	instr.len = c->sector_size;
+	instr.callback = jffs2_checkpoint_erase_callback;
+	instr.priv = (unsigned long)&done;
+
+	ret = mtd_erase(c->mtd, &instr);
+	if (ret)
+		return ret;
+
+	wait_for_completion(&done);
+	return instr.state == MTD_ERASE_DONE ? 0 : -EIO;
+}
+
+struct jffs2_checkpoint_image *jffs2_checkpoint_load(struct jffs2_sb_info *c)
+{
+	struct jffs2_checkpoint_image *img;
+	struct jffs2_raw_checkpoint *node;
+	struct jffs2_eraseblock *jeb;
+	uint32_t totlen, pos, i;
+	size_t size, retlen;
+	int ret;
+
+	if (!c->mount_opts.checkpoint)
+		return NULL;
+
+	jeb = jffs2_checkpoint_target(c);
+	if (!jeb)
+		return NULL;
+
+	size = c->sector_size;
+	node = mtd_kmalloc_up_to(c->mtd, &size);
+	if (!node)
+		return NULL;
+
+	ret = jffs2_flash_read(c, jeb->offset, sizeof(*node), &retlen,
+			       (unsigned char *)node);
+	if (ret || retlen != sizeof(*node))
+		goto out_free;
+
+	if (je16_to_cpu(node->magic) != JFFS2_MAGIC_BITMASK ||
+	    je16_to_cpu(node->nodetype) != JFFS2_NODETYPE_CHECKPOINT) {
+		jffs2_dbg(1, "No checkpoint at 0x%08x\n", jeb->offset);
+		goto out_free;
+	}
+
+	if (je32_to_cpu(node->hdr_crc) !=
+	    crc32(0, node, sizeof(struct jffs2_unknown_node) - 4) ||
+	    je32_to_cpu(node->node_crc) != crc32(0, node, sizeof(*node) - 4))
+		goto bad;
+
+	totlen = je32_to_cpu(node->totlen);
+	pos = sizeof(*node) + c->nr_blocks * sizeof(node->blocks[0]);
+	if (je32_to_cpu(node->nr_blocks) != c->nr_blocks ||
+	    je32_to_cpu(node->sector_size) != c->sector_size ||
+	    totlen > size || totlen < pos)
+		goto bad;
+
+	ret = jffs2_flash_read(c, jeb->offset + sizeof(*node),
+			       totlen - sizeof(*node), &retlen,
+			       (unsigned char *)node->blocks);
+	if (ret || retlen != totlen - sizeof(*node))
+		goto bad;
+
+	if (je32_to_cpu(node->data_crc) !=
+	    crc32(0, node->blocks, totlen - sizeof(*node)))
+		goto bad;
+
+	/* Don't trust any of it unless the table is consistent, too */
+	if (node->blocks[jeb - c->blocks].state != JFFS2_CP_BLOCK_CHECKPOINT)
+		goto bad;
+
+	for (i = 0; i < c->nr_blocks; i++) {
+		struct jffs2_checkpoint_entry *e = &node->blocks[i];
+		uint32_t sumlen = je32_to_cpu(e->sumlen);
+
+		switch (e->state) {
+		case JFFS2_CP_BLOCK_SUMMARY:
+			if (sumlen < sizeof(struct jffs2_raw_summary) ||
+			    sumlen >= c->sector_size ||
+			    PAD(sumlen) > totlen - pos)
+				goto bad;
+			pos += PAD(sumlen);
+			break;
+
+		case JFFS2_CP_BLOCK_CHECKPOINT:
+			if (&c->blocks[i] != jeb)
+				goto bad;
+			break;
+
+		case JFFS2_CP_BLOCK_SCAN:
+		case JFFS2_CP_BLOCK_FREE:
+		case JFFS2_CP_BLOCK_BAD:
+			break;
+
+		default:
+			goto bad;
+		}
+	}
+
+	img = kmalloc(sizeof(*img), GFP_KERNEL);
+	if (!img)
+		goto out_free;
+
+	img->node = node;
+	img->next = 0;
+	img->pos = sizeof(*node) + c->nr_blocks * sizeof(node->blocks[0]);
+
+	pr_info("Mounting from checkpoint at 0x%08x\n", jeb->offset);
+	return img;
+
+ bad:
+	pr_notice("Checkpoint at 0x%08x is corrupt, doing a full scan\n",
+		  jeb->offset);
+ out_free:
+	kfree(node);
+	return NULL;
+}
+
+void jffs2_checkpoint_free(struct jffs2_checkpoint_image *img)
+{
+	if (!img)
+		return;
+	kfree(img->node);
+	kfree(img);
+}
+
+/*
+ * Called by jffs2_scan_medium() for each block, in order. Returns a
+ * BLK_STATE_xxx if the checkpoint was enough to set the block up, zero
+ * if it still has to be scanned, or a negative error.
+ */
+int jffs2_checkpoint_scan_block(struct jffs2_sb_info *c,
+				struct jffs2_checkpoint_image *img,
+				struct jffs2_eraseblock *jeb,
+				uint32_t *pseudo_random)
+{
+	struct jffs2_checkpoint_entry *e;
+	uint32_t sumlen;
+	int ret;
+
+	if (!img || jeb - c->blocks != img->next)
+		return 0;
+
+	e = &img->node->blocks[img->next++];
+	sumlen = je32_to_cpu(e->sumlen);
+
+	switch (e->state) {
+	case JFFS2_CP_BLOCK_FREE:
+		if (c->cleanmarker_size) {
+			ret = jffs2_prealloc_raw_node_refs(c, jeb, 1);
+			if (ret)
+				return ret;
+			jffs2_link_node_ref(c, jeb, jeb->offset | REF_NORMAL,
+					    c->cleanmarker_size, NULL);
+		}
+		return BLK_STATE_CLEANMARKER;
+
+	case JFFS2_CP_BLOCK_BAD:
+		return BLK_STATE_BADBLOCK;
+
+	case JFFS2_CP_BLOCK_CHECKPOINT:
+		return BLK_STATE_CHECKPOINT;
+
+	case JFFS2_CP_BLOCK_SUMMARY:
+		ret = jffs2_sum_scan_sumnode(c, jeb,
+				(void *)img->node + img->pos, sumlen,
+				pseudo_random);
+		img->pos += PAD(sumlen);
+		/* Zero means the summary didn't cover everything; the
+		   caller falls back to scanning the block. */
+		return ret;
+	}
+
+	return 0;
+}
+
+/*
+ * The scan found a checkpoint node at the start of @jeb. If it is where
+ * we keep ours and we're going to keep writing checkpoints, take the block
+ * out of circulation and return 1. Otherwise the block is the caller's to
+ * erase; either way, nothing may be written before it has been destroyed.
+ */
+int jffs2_checkpoint_adopt(struct jffs2_sb_info *c, struct jffs2_eraseblock *jeb)
+{
+	if (jeb != jffs2_checkpoint_target(c))
+		return 0;
+
+	c->cp_jeb = jeb;
+	c->cp_valid = 1;
+
+	if (!c->mount_opts.checkpoint)
+		return 0;
+
+	list_add(&jeb->list, &c->bad_list);
+	c->bad_size += c->sector_size;
+	c->free_size -= c->sector_size;
+	c->cp_reserved = 1;
+	return 1;
+}
+
+static int jffs2_checkpoint_on_list(struct jffs2_eraseblock *jeb,
+				    struct list_head *head)
+{
+	struct jffs2_eraseblock *pos;
+
+	list_for_each_entry(pos, head, list) {
+		if (pos == jeb)
+			return 1;
+	}
+	return 0;
+}
+
+/*
+ * Make sure we own the checkpoint block. If it's free we take it now.
+ * If it holds data, point the garbage collector at it so that it's free
+ * next time round. Called with alloc_sem held.
+ */
+static int jffs2_checkpoint_claim(struct jffs2_sb_info *c)
+{
+	struct jffs2_eraseblock *jeb;
+
+	if (c->cp_reserved)
+		return 1;
+
+	jeb = jffs2_checkpoint_target(c);
+	if (!jeb)
+		return 0;
+
+	spin_lock(&c->erase_completion_lock);
+	if (jffs2_checkpoint_on_list(jeb, &c->free_list)) {
+		if (c->nr_free_blocks > c->resv_blocks_write) {
+			list_move(&jeb->list, &c->bad_list);
+			c->nr_free_blocks--;
+			c->free_size -= jeb->free_size;
+			c->used_size -= jeb->used_size;
+			c->dirty_size -= jeb->dirty_size;
+			c->wasted_size -= jeb->wasted_size;
+			c->unchecked_size -= jeb->unchecked_size;
+			jeb->free_size = jeb->used_size = jeb->dirty_size = 0;
+			jeb->wasted_size = jeb->unchecked_size = 0;
+			jffs2_free_jeb_node_refs(c, jeb);
+			c->bad_size += c->sector_size;
+			c->cp_jeb = jeb;
+			c->cp_reserved = 1;
+			c->cp_erased = 0;	/* it holds a cleanmarker */
+			jffs2_dbg(1, "Reserved block at 0x%08x for checkpoints\n",
+				  jeb->offset);
+		}
+	} else if (!c->gcblock && jeb != c->nextblock && jeb->first_node &&
+		   (jffs2_checkpoint_on_list(jeb, &c->clean_list) ||
+		    jffs2_checkpoint_on_list(jeb, &c->dirty_list) ||
+		    jffs2_checkpoint_on_list(jeb, &c->very_dirty_list))) {
+		jffs2_dbg(1, "Evacuating block at 0x%08x for checkpoints\n",
+			  jeb->offset);
+		list_del(&jeb->list);
+		c->gcblock = jeb;
+		jeb->gc_node = jeb->first_node;
+		if (jeb->wasted_size) {
+			jeb->dirty_size += jeb->wasted_size;
+			c->wasted_size -= jeb->wasted_size;
+			c->dirty_size += jeb->wasted_size;
+			jeb->wasted_size = 0;
+		}
+	}
+	spin_unlock(&c->erase_completion_lock);
+
+	return c->cp_reserved;
+}
+
+static void jffs2_checkpoint_mark(struct jffs2_sb_info *c,
+				  struct jffs2_raw_checkpoint *node,
+				  struct list_head *head, uint8_t state)
+{
+	struct jffs2_eraseblock *jeb;
+
+	list_for_each_entry(jeb, head, list)
+		node->blocks[jeb - c->blocks].state = state;
+}
+
+/* Copy the summary node at the end of @jeb into @buf. Returns its length,
+   or zero if the block has no usable summary or it doesn't fit. */
+static uint32_t jffs2_checkpoint_copy_summary(struct jffs2_sb_info *c,
+					      struct jffs2_eraseblock *jeb,
+					      void *buf, uint32_t avail)
+{
+	struct jffs2_sum_marker sm;
+	uint32_t sumofs, sumlen;
+	size_t retlen;
+	int ret;
+
+	ret = jffs2_flash_read(c, jeb->offset + c->sector_size - sizeof(sm),
+			       sizeof(sm), &retlen, (unsigned char *)&sm);
+	if (ret || retlen != sizeof(sm) ||
+	    je32_to_cpu(sm.magic) != JFFS2_SUM_MAGIC)
+		return 0;
+
+	sumofs = je32_to_cpu(sm.offset);
+	if (sumofs >= c->sector_size)
+		return 0;
+
+	sumlen = c->sector_size - sumofs;
+	if (sumlen < sizeof(struct jffs2_raw_summary) || PAD(sumlen) > avail)
+		return 0;
+
+	ret = jffs2_flash_read(c, jeb->offset + sumofs, sumlen, &retlen, buf);
+	if (ret || retlen != sumlen)
+		return 0;
+
+	return sumlen;
+}
+
+/*
+ * Write a fresh checkpoint. Called with alloc_sem held, after the garbage
+ * collector has been stopped and the write buffer flushed, when the file
+ * system is about to go read-only.
+ */
+int jffs2_checkpoint_write(struct jffs2_sb_info *c)
+{
+	struct jffs2_raw_checkpoint *node;
+	size_t size, retlen;
+	uint32_t pos, len, i;
+	int ret = 0;
+
+	if (!c->mount_opts.checkpoint || jffs2_is_readonly(c))
+		return 0;
+
+	mutex_lock(&c->cp_mutex);
+	if (c->cp_valid)
+		goto out_unlock;
+	if (!jffs2_checkpoint_claim(c))
+		goto out_unlock;
+
+	size = c->sector_size;
+	node = mtd_kmalloc_up_to(c->mtd, &size);
+	if (!node) {
+		ret = -ENOMEM;
+		goto out_unlock;
+	}
+
+	pos = sizeof(*node) + c->nr_blocks * sizeof(node->blocks[0]);
+	if (pos > size) {
+		jffs2_dbg(1, "Too many eraseblocks for a checkpoint\n");
+		goto out_free;
+	}
+	memset(node, 0, size);
+
+	/* Nothing can change the flash until jffs2_checkpoint_start() */
+	c->cp_valid = 1;
+
+	spin_lock(&c->erase_completion_lock);
+	jffs2_checkpoint_mark(c, node, &c->free_list, JFFS2_CP_BLOCK_FREE);
+	jffs2_checkpoint_mark(c, node, &c->bad_list, JFFS2_CP_BLOCK_BAD);
+	jffs2_checkpoint_mark(c, node, &c->clean_list, JFFS2_CP_BLOCK_SUMMARY);
+	jffs2_checkpoint_mark(c, node, &c->dirty_list, JFFS2_CP_BLOCK_SUMMARY);
+	jffs2_checkpoint_mark(c, node, &c->very_dirty_list, JFFS2_CP_BLOCK_SUMMARY);
+	spin_unlock(&c->erase_completion_lock);
+	node->blocks[c->cp_jeb - c->blocks].state = JFFS2_CP_BLOCK_CHECKPOINT;
+
+	for (i = 0; i < c->nr_blocks; i++) {
+		struct jffs2_checkpoint_entry *e = &node->blocks[i];
+
+		if (e->state != JFFS2_CP_BLOCK_SUMMARY)
+			continue;
+
+		/* Once it's full the remaining blocks just get scanned */
+		len = jffs2_checkpoint_copy_summary(c, &c->blocks[i],
+						    (void *)node + pos,
+						    size - pos);
+		if (!len) {
+			e->state = JFFS2_CP_BLOCK_SCAN;
+			continue;
+		}
+		e->sumlen = cpu_to_je32(len);
+		pos += PAD(len);
+	}
+
+	node->magic = cpu_to_je16(JFFS2_MAGIC_BITMASK);
+	node->nodetype = cpu_to_je16(JFFS2_NODETYPE_CHECKPOINT);
+	node->totlen = cpu_to_je32(pos);
+	node->hdr_crc = cpu_to_je32(crc32(0, node, sizeof(struct jffs2_unknown_node) - 4));
+	node->nr_blocks = cpu_to_je32(c->nr_blocks);
+	node->sector_size = cpu_to_je32(c->sector_size);
+	node->data_crc = cpu_to_je32(crc32(0, node->blocks, pos - sizeof(*node)));
+	node->node_crc = cpu_to_je32(crc32(0, node, sizeof(*node) - 4));
+
+	len = min_t(uint32_t, ALIGN(pos, c->mtd->writesize), size);
+	memset((void *)node + pos, 0xff, len - pos);
+
+	/* Usually jffs2_checkpoint_start() left the block erased for us */
+	if (!c->cp_erased)
+		ret = jffs2_checkpoint_erase(c, c->cp_jeb);
+	c->cp_erased = 0;
+	if (!ret)
+		ret = mtd_write(c->mtd, c->cp_jeb->offset, len, &retlen,
+				(unsigned char *)node);
+	if (!ret && retlen != len)
+		ret = -EIO;
+
+	if (ret) {
+		/* Whatever made it to the flash won't pass the CRC checks */
+		pr_warn("Failed to write checkpoint at 0x%08x: %d\n",
+			c->cp_jeb->offset, ret);
+		c->cp_valid = 0;
+	} else {
+		jffs2_dbg(1, "Wrote 0x%x byte checkpoint at 0x%08x\n",
+			  pos, c->cp_jeb->offset);
+	}
+
+ out_free:
+	kfree(node);
+ out_unlock:
+	mutex_unlock(&c->cp_mutex);
+	return ret;
+}
+
+/* Destroy the checkpoint before the flash changes under it. */
+static void jffs2_checkpoint_invalidate(struct jffs2_sb_info *c)
+{
+	struct jffs2_eraseblock *jeb;
+	uint32_t zero = 0;
+	size_t retlen;
+	int ret;
+
+	if (!c->cp_valid)
+		return;
+
+	jeb = c->cp_jeb;
+	if (!jffs2_checkpoint_erase(c, jeb)) {
+		c->cp_erased = 1;
+	} else {
+		/* Make sure nobody ever trusts it again, one way or another */
+		if (mtd_can_have_bb(c->mtd))
+			ret = mtd_block_markbad(c->mtd, jeb->offset);
+		else
+			ret = mtd_write(c->mtd, jeb->offset, sizeof(zero),
+					&retlen, (unsigned char *)&zero);
+		if (ret)
+			pr_crit("Cannot destroy stale checkpoint at 0x%08x; do not mount with -o checkpoint\n",
+				jeb->offset);
+		c->cp_reserved = 0;
+	}
+	c->cp_valid = 0;
+	if (!c->cp_reserved)
+		c->cp_jeb = NULL;
+}
+
+/*
+ * Called whenever the file system goes read-write, before the garbage
+ * collector is started and so before anything can be written or erased.
+ * Destroys the checkpoint we may have mounted from, which leaves its block
+ * erased for the next one, and makes sure that block will be ours by the
+ * time that gets written.
+ */
+void jffs2_checkpoint_start(struct jffs2_sb_info *c)
+{
+	mutex_lock(&c->alloc_sem);
+	mutex_lock(&c->cp_mutex);
+	jffs2_checkpoint_invalidate(c);
+	if (c->mount_opts.checkpoint)
+		jffs2_checkpoint_claim(c);
+	mutex_unlock(&c->cp_mutex);
+	mutex_unlock(&c->alloc_sem);
+}
@@ -0,0 +1,71 @@
+/*
+ * JFFS2 -- Journalling Flash File System, Version 2.
+ *
+ * Copyright © 2001-2007 Red Hat, Inc.
+ *
+ * For licensing information, see the file 'LICENCE' in this directory.
+ *
+ */
+
+#ifndef JFFS2_CHECKPOINT_H
+#define JFFS2_CHECKPOINT_H
+
+#include <linux/jffs2.h>
+
+/* What the checkpoint knows about each eraseblock */
+#define JFFS2_CP_BLOCK_SCAN		0	/* Nothing; scan it as usual */
+#define JFFS2_CP_BLOCK_FREE		1	/* Erased, holds only a cleanmarker */
+#define JFFS2_CP_BLOCK_BAD		2	/* Bad block */
+#define JFFS2_CP_BLOCK_SUMMARY		3	/* Copy of its summary node follows */
+#define JFFS2_CP_BLOCK_CHECKPOINT	4	/* Holds the checkpoint itself */
+
+struct jffs2_checkpoint_entry
+{
+	__u8 state;		/* JFFS2_CP_BLOCK_xxx */
+	__u8 unused[3];
+	jint32_t sumlen;	/* length of the summary copy, if any */
+} __attribute__((packed));
+
+/* The checkpoint node lives at the start of the first good eraseblock.
+   It is followed by one jffs2_checkpoint_entry for every eraseblock and
+   then, in block order, by verbatim copies of the summary nodes of the
+   blocks marked JFFS2_CP_BLOCK_SUMMARY, each padded to 4 bytes. */
+struct jffs2_raw_checkpoint
+{
+	jint16_t magic;
+	jint16_t nodetype;	/* = JFFS2_NODETYPE_CHECKPOINT */
+	jint32_t totlen;
+	jint32_t hdr_crc;
+	jint32_t nr_blocks;	/* number of eraseblocks described */
+	jint32_t sector_size;	/* eraseblock size it was written with */
+	jint32_t data_crc;	/* CRC of the block table and summaries */
+	jint32_t node_crc;	/* CRC of this header up to node_crc */
+	struct jffs2_checkpoint_entry blocks[0];
+} __attribute__((packed));
+
+struct jffs2_checkpoint_image;
+
+#ifdef CONFIG_JFFS2_CHECKPOINT
+
+struct jffs2_checkpoint_image *jffs2_checkpoint_load(struct jffs2_sb_info *c);
+void jffs2_checkpoint_free(struct jffs2_checkpoint_image *img);
+int jffs2_checkpoint_scan_block(struct jffs2_sb_info *c,
+				struct jffs2_checkpoint_image *img,
+				struct jffs2_eraseblock *jeb,
+				uint32_t *pseudo_random);
+int jffs2_checkpoint_adopt(struct jffs2_sb_info *c, struct jffs2_eraseblock *jeb);
+int jffs2_checkpoint_write(struct jffs2_sb_info *c);
+void jffs2_checkpoint_start(struct jffs2_sb_info *c);
+
+#else
+
+#define jffs2_checkpoint_load(c) (NULL)
+#define jffs2_checkpoint_free(img) do { } while (0)
+#define jffs2_checkpoint_scan_block(c, img, jeb, pr) (0)
+#define jffs2_checkpoint_adopt(c, jeb) (0)
+#define jffs2_checkpoint_write(c) (0)
+#define jffs2_checkpoint_start(c) do { } while (0)
+
+#endif /* CONFIG_JFFS2_CHECKPOINT */
+
+#endif /* JFFS2_CHECKPOINT_H */
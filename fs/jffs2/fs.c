@@ -24,6 +24,7 @@
 #include <linux/vfs.h>
 #include <linux/crc32.h>
 #include "nodelist.h"
+#include "checkpoint.h"
 
 static int jffs2_flash_setup(struct jffs2_sb_info *c);
 
@@ -407,11 +408,15 @@ int jffs2_do_remount_fs(struct super_block *sb, int *flags, char *data)
 		jffs2_stop_garbage_collect_thread(c);
 		mutex_lock(&c->alloc_sem);
 		jffs2_flush_wbuf_pad(c);
+		if (*flags & MS_RDONLY)
+			jffs2_checkpoint_write(c);
 		mutex_unlock(&c->alloc_sem);
 	}
 
-	if (!(*flags & MS_RDONLY))
+	if (!(*flags & MS_RDONLY)) {
+		jffs2_checkpoint_start(c);
 		jffs2_start_garbage_collect_thread(c);
+	}
 
 	*flags |= MS_NOATIME;
 	return 0;
@@ -591,8 +596,10 @@ int jffs2_do_fill_super(struct super_block *sb, void *data, int silent)
 	sb->s_blocksize = PAGE_CACHE_SIZE;
 	sb->s_blocksize_bits = PAGE_CACHE_SHIFT;
 	sb->s_magic = JFFS2_SUPER_MAGIC;
-	if (!(sb->s_flags & MS_RDONLY))
+	if (!(sb->s_flags & MS_RDONLY)) {
+		jffs2_checkpoint_start(c);
 		jffs2_start_garbage_collect_thread(c);
+	}
 	return 0;
 
 out_root:
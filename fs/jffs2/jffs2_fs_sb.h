@@ -39,6 +39,8 @@ struct jffs2_mount_opts {
 	 * latter users to write to the file system if the amount if the
 	 * available space is less then 'rp_size'. */
 	unsigned int rp_size;
+
+	bool checkpoint;	/* Maintain a mount checkpoint */
 };
 
 /* A struct for the overall file system control.  Pointers to
@@ -144,6 +146,16 @@ struct jffs2_sb_info {
 	struct jffs2_summary *summary;		/* Summary information */
 	struct jffs2_mount_opts mount_opts;
 
+#ifdef CONFIG_JFFS2_CHECKPOINT
+	struct mutex cp_mutex;			/* Protects the following */
+	struct jffs2_eraseblock *cp_jeb;	/* Block holding the checkpoint */
+	int cp_valid;				/* cp_jeb holds a checkpoint which
+						   has to go before the next write */
+	int cp_reserved;			/* cp_jeb is kept on the bad_list
+						   for our own use */
+	int cp_erased;				/* cp_jeb is erased and ready */
+#endif
+
 #ifdef CONFIG_JFFS2_FS_XATTR
 #define XATTRINDEX_HASHSIZE	(57)
 	uint32_t highest_xid;
@@ -20,6 +20,7 @@
 #include <linux/compiler.h>
 #include "nodelist.h"
 #include "summary.h"
+#include "checkpoint.h"
 #include "debug.h"
 
 #define DEFAULT_EMPTY_SCAN_SIZE 256
@@ -95,6 +96,7 @@ int jffs2_scan_medium(struct jffs2_sb_info *c)
 	unsigned char *flashbuf = NULL;
 	uint32_t buf_size = 0;
 	struct jffs2_summary *s = NULL; /* summary info collected by the scan process */
+	struct jffs2_checkpoint_image *cp = NULL;
 #ifndef __ECOS
 	size_t pointlen, try_size;
 
@@ -140,6 +142,8 @@ int jffs2_scan_medium(struct jffs2_sb_info *c)
 		}
 	}
 
+	cp = jffs2_checkpoint_load(c);
+
 	for (i=0; i<c->nr_blocks; i++) {
 		struct jffs2_eraseblock *jeb = &c->blocks[i];
 
@@ -148,8 +152,10 @@ int jffs2_scan_medium(struct jffs2_sb_info *c)
 		/* reset summary info for next eraseblock scan */
 		jffs2_sum_reset_collected(s);
 
-		ret = jffs2_scan_eraseblock(c, jeb, buf_size?flashbuf:(flashbuf+jeb->offset),
-						buf_size, s);
+		ret = jffs2_checkpoint_scan_block(c, cp, jeb, &pseudo_random);
+		if (!ret)
+			ret = jffs2_scan_eraseblock(c, jeb, buf_size?flashbuf:(flashbuf+jeb->offset),
+						    buf_size, s);
 
 		if (ret < 0)
 			goto out;
@@ -233,6 +239,20 @@ int jffs2_scan_medium(struct jffs2_sb_info *c)
 			c->free_size -= c->sector_size;
 			bad_blocks++;
 			break;
+
+		case BLK_STATE_CHECKPOINT:
+			/* Either we keep it for our own checkpoints, or it
+			   gets erased like any other garbage. */
+			if (jffs2_checkpoint_adopt(c, jeb)) {
+				jffs2_dbg(1, "Block at 0x%08x holds the checkpoint\n",
+					  jeb->offset);
+				bad_blocks++;
+				break;
+			}
+			list_add(&jeb->list, &c->erase_pending_list);
+			c->nr_erasing_blocks++;
+			break;
+
 		default:
 			pr_warn("%s(): unknown block state\n", __func__);
 			BUG();
@@ -280,6 +300,7 @@ int jffs2_scan_medium(struct jffs2_sb_info *c)
 	else
 		mtd_unpoint(c->mtd, 0, c->mtd->size);
 #endif
+	jffs2_checkpoint_free(cp);
 	kfree(s);
 	return ret;
 }
@@ -879,6 +900,20 @@ scan_more:
 			}
 			break;
 
+#ifdef CONFIG_JFFS2_CHECKPOINT
+		case JFFS2_NODETYPE_CHECKPOINT:
+			if (ofs == jeb->offset) {
+				jffs2_dbg(1, "Checkpoint node found at 0x%08x\n", ofs);
+				return BLK_STATE_CHECKPOINT;
+			}
+			pr_notice("Checkpoint node found at 0x%08x, not at start of block\n",
+				  ofs);
+			if ((err = jffs2_scan_dirty_space(c, jeb, PAD(je32_to_cpu(node->totlen)))))
+				return err;
+			ofs += PAD(je32_to_cpu(node->totlen));
+			break;
+#endif
+
 		case JFFS2_NODETYPE_PADDING:
 			if (jffs2_sum_active())
 				jffs2_sum_add_padding_mem(s, je32_to_cpu(node->totlen));
@@ -28,6 +28,7 @@
 #define BLK_STATE_CLEANMARKER	3
 #define BLK_STATE_ALLDIRTY	4
 #define BLK_STATE_BADBLOCK	5
+#define BLK_STATE_CHECKPOINT	6
 
 #define JFFS2_SUMMARY_NOSUM_SIZE 0xffffffff
 #define JFFS2_SUMMARY_INODE_SIZE (sizeof(struct jffs2_sum_inode_flash))
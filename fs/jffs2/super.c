@@ -29,6 +29,7 @@
 #include <linux/exportfs.h>
 #include "compr.h"
 #include "nodelist.h"
+#include "checkpoint.h"
 
 static void jffs2_put_super(struct super_block *);
 
@@ -92,6 +93,8 @@ static int jffs2_show_options(struct seq_file *s, struct dentry *root)
 		seq_printf(s, ",compr=%s", jffs2_compr_name(opts->compr));
 	if (opts->rp_size)
 		seq_printf(s, ",rp_size=%u", opts->rp_size / 1024);
+	if (opts->checkpoint)
+		seq_puts(s, ",checkpoint");
 
 	return 0;
 }
@@ -161,17 +164,22 @@ static const struct export_operations jffs2_export_ops = {
  *
  * Opt_override_compr: override default compressor
  * Opt_rp_size: size of reserved pool in KiB
+ * Opt_checkpoint: maintain a checkpoint for faster mounting
  * Opt_err: just end of array marker
  */
 enum {
 	Opt_override_compr,
 	Opt_rp_size,
+	Opt_checkpoint,
 	Opt_err,
 };
 
 static const match_table_t tokens = {
 	{Opt_override_compr, "compr=%s"},
 	{Opt_rp_size, "rp_size=%u"},
+#ifdef CONFIG_JFFS2_CHECKPOINT
+	{Opt_checkpoint, "checkpoint"},
+#endif
 	{Opt_err, NULL},
 };
 
@@ -228,6 +236,9 @@ static int jffs2_parse_options(struct jffs2_sb_info *c, char *data)
 			}
 			c->mount_opts.rp_size = opt;
 			break;
+		case Opt_checkpoint:
+			c->mount_opts.checkpoint = true;
+			break;
 		default:
 			pr_err("Error: unrecognized mount option '%s' or missing value\n",
 			       p);
@@ -298,6 +309,9 @@ static int jffs2_fill_super(struct super_block *sb, void *data, int silent)
 	init_waitqueue_head(&c->inocache_wq);
 	spin_lock_init(&c->erase_completion_lock);
 	spin_lock_init(&c->inocache_lock);
+#ifdef CONFIG_JFFS2_CHECKPOINT
+	mutex_init(&c->cp_mutex);
+#endif
 
 	sb->s_op = &jffs2_super_operations;
 	sb->s_export_op = &jffs2_export_ops;
@@ -325,6 +339,7 @@ static void jffs2_put_super (struct super_block *sb)
 
 	mutex_lock(&c->alloc_sem);
 	jffs2_flush_wbuf_pad(c);
+	jffs2_checkpoint_write(c);
 	mutex_unlock(&c->alloc_sem);
 
 	jffs2_sum_exit(c);
@@ -115,9 +115,9 @@ int kernfs_setattr(struct kernfs_node *kn, const struct iattr *iattr)
 {
 	int ret;
 
-	mutex_lock(&kernfs_mutex);
+	down_write(&kernfs_rwsem);
 	ret = __kernfs_setattr(kn, iattr);
-	mutex_unlock(&kernfs_mutex);
+	up_write(&kernfs_rwsem);
 	return ret;
 }
 
@@ -130,7 +130,7 @@ int kernfs_iop_setattr(struct dentry *dentry, struct iattr *iattr)
 	if (!kn)
 		return -EINVAL;
 
-	mutex_lock(&kernfs_mutex);
+	down_write(&kernfs_rwsem);
 	error = inode_change_ok(inode, iattr);
 	if (error)
 		goto out;
@@ -143,7 +143,7 @@ int kernfs_iop_setattr(struct dentry *dentry, struct iattr *iattr)
 	setattr_copy(inode, iattr);
 
 out:
-	mutex_unlock(&kernfs_mutex);
+	up_write(&kernfs_rwsem);
 	return error;
 }
 
@@ -193,9 +193,9 @@ int kernfs_iop_setxattr(struct dentry *dentry, const char *name,
 		if (error)
 			return error;
 
-		mutex_lock(&kernfs_mutex);
+		down_write(&kernfs_rwsem);
 		error = kernfs_node_setsecdata(kn, &secdata, &secdata_len);
-		mutex_unlock(&kernfs_mutex);
+		up_write(&kernfs_rwsem);
 
 		if (secdata)
 			security_release_secctx(secdata, secdata_len);
@@ -260,10 +260,15 @@ static inline void set_inode_attr(struct inode *inode, struct iattr *iattr)
 	inode->i_ctime = iattr->ia_ctime;
 }
 
+/*
+ * Called with kernfs_rwsem held for reading, so there may be several of
+ * us refreshing the same inode; i_lock keeps the attributes consistent.
+ */
 static void kernfs_refresh_inode(struct kernfs_node *kn, struct inode *inode)
 {
 	struct kernfs_iattrs *attrs = kn->iattr;
 
+	spin_lock(&inode->i_lock);
 	inode->i_mode = kn->mode;
 	if (attrs) {
 		/*
@@ -271,12 +276,33 @@ static void kernfs_refresh_inode(struct kernfs_node *kn, struct inode *inode)
 		 * persistent copy in kernfs_node.
 		 */
 		set_inode_attr(inode, &attrs->ia_iattr);
-		security_inode_notifysecctx(inode, attrs->ia_secdata,
-					    attrs->ia_secdata_len);
 	}
 
 	if (kernfs_type(kn) == KERNFS_DIR)
 		set_nlink(inode, kn->dir.subdirs + 2);
+	spin_unlock(&inode->i_lock);
+
+	if (attrs)
+		security_inode_notifysecctx(inode, attrs->ia_secdata,
+					    attrs->ia_secdata_len);
+}
+
+/*
+ * Lockless check, for RCU path walk, that @inode already reflects
+ * everything kernfs_refresh_inode() would copy for a permission check.
+ */
+static bool kernfs_inode_current(struct kernfs_node *kn, struct inode *inode)
+{
+	struct kernfs_iattrs *attrs = ACCESS_ONCE(kn->iattr);
+
+	if (inode->i_mode != ACCESS_ONCE(kn->mode))
+		return false;
+	if (!attrs)
+		return true;
+	if (attrs->ia_secdata)
+		return false;
+	return uid_eq(inode->i_uid, attrs->ia_iattr.ia_uid) &&
+	       gid_eq(inode->i_gid, attrs->ia_iattr.ia_gid);
 }
 
 int kernfs_iop_getattr(struct vfsmount *mnt, struct dentry *dentry,
@@ -285,9 +311,9 @@ int kernfs_iop_getattr(struct vfsmount *mnt, struct dentry *dentry,
 	struct kernfs_node *kn = dentry->d_fsdata;
 	struct inode *inode = dentry->d_inode;
 
-	mutex_lock(&kernfs_mutex);
+	down_read(&kernfs_rwsem);
 	kernfs_refresh_inode(kn, inode);
-	mutex_unlock(&kernfs_mutex);
+	up_read(&kernfs_rwsem);
 
 	generic_fillattr(inode, stat);
 	return 0;
@@ -370,14 +396,18 @@ int kernfs_iop_permission(struct inode *inode, int mask)
 {
 	struct kernfs_node *kn;
 
-	if (mask & MAY_NOT_BLOCK)
-		return -ECHILD;
-
 	kn = inode->i_private;
 
-	mutex_lock(&kernfs_mutex);
+	/* kernfs_nodes are freed after a grace period, see kernfs_put() */
+	if (mask & MAY_NOT_BLOCK) {
+		if (!kernfs_inode_current(kn, inode))
+			return -ECHILD;
+		return generic_permission(inode, mask);
+	}
+
+	down_read(&kernfs_rwsem);
 	kernfs_refresh_inode(kn, inode);
-	mutex_unlock(&kernfs_mutex);
+	up_read(&kernfs_rwsem);
 
 	return generic_permission(inode, mask);
 }
@@ -127,6 +127,7 @@
 #include <linux/rcupdate.h>
 #include <linux/pid_namespace.h>
 #include <linux/hashtable.h>
+#include <linux/hash.h>
 #include <linux/percpu.h>
 #include <linux/lglock.h>
 
@@ -181,24 +182,35 @@ static DEFINE_PER_CPU(struct hlist_head, file_lock_list);
 static DEFINE_HASHTABLE(blocked_hash, BLOCKED_HASH_BITS);
 
 /*
- * This lock protects the blocked_hash. Generally, if you're accessing it, you
- * want to be holding this lock.
+ * This lock protects the blocked_hash, and with it POSIX deadlock detection.
+ * Only waiters blocked on a classic (non-OFD) POSIX lock are hashed, so
+ * flock, lease and OFD-on-OFD waits never take it.
  *
- * In addition, it also protects the fl->fl_block list, and the fl->fl_next
- * pointer for file_lock structures that are acting as lock requests (in
- * contrast to those that are acting as records of acquired locks).
- *
- * Note that when we acquire this lock in order to change the above fields,
- * we often hold the i_lock as well. In certain cases, when reading the fields
- * protected by this lock, we can skip acquiring it iff we already hold the
- * i_lock.
- *
- * In particular, adding an entry to the fl_block list requires that you hold
- * both the i_lock and the blocked_lock_lock (acquired in that order). Deleting
- * an entry from the list however only requires the file_lock_lock.
+ * A hashed waiter's fl_next is only changed with this lock held, so the
+ * deadlock walk may follow it to the blocker; the blocker cannot be freed
+ * while a hashed waiter still points at it.
  */
 static DEFINE_SPINLOCK(blocked_lock_lock);
 
+/*
+ * The fl->fl_block lists, and the fl->fl_next pointer of file_locks that are
+ * acting as lock requests (in contrast to those that are acting as records
+ * of acquired locks), are protected by one of a small array of locks hashed
+ * by inode; waiter and blocker always belong to the same inode.
+ *
+ * Adding an entry to an fl_block list requires the i_lock as well, so that
+ * holders of the i_lock can check for an empty list without taking the
+ * list lock. The locking order is i_lock, then the list lock, then
+ * blocked_lock_lock.
+ */
+#define BLOCKED_LIST_LOCK_BITS	6
+static spinlock_t blocked_list_locks[1 << BLOCKED_LIST_LOCK_BITS];
+
+static spinlock_t *blocked_list_lock(struct inode *inode)
+{
+	return &blocked_list_locks[hash_ptr(inode, BLOCKED_LIST_LOCK_BITS)];
+}
+
 static struct kmem_cache *filelock_cache __read_mostly;
 
 static void locks_init_lock_heads(struct file_lock *fl)
@@ -520,20 +532,26 @@ static void locks_delete_global_blocked(struct file_lock *waiter)
 /* Remove waiter from blocker's block list.
  * When blocker ends up pointing to itself then the list is empty.
  *
- * Must be called with blocked_lock_lock held.
+ * Must be called with the inode's blocked list lock held.
  */
 static void __locks_delete_block(struct file_lock *waiter)
 {
-	locks_delete_global_blocked(waiter);
+	if (!hlist_unhashed(&waiter->fl_link)) {
+		spin_lock(&blocked_lock_lock);
+		locks_delete_global_blocked(waiter);
+		spin_unlock(&blocked_lock_lock);
+	}
 	list_del_init(&waiter->fl_block);
 	waiter->fl_next = NULL;
 }
 
-static void locks_delete_block(struct file_lock *waiter)
+static void locks_delete_block(struct inode *inode, struct file_lock *waiter)
 {
-	spin_lock(&blocked_lock_lock);
+	spinlock_t *lock = blocked_list_lock(inode);
+
+	spin_lock(lock);
 	__locks_delete_block(waiter);
-	spin_unlock(&blocked_lock_lock);
+	spin_unlock(lock);
 }
 
 /* Insert waiter into blocker's block list.
@@ -541,10 +559,9 @@ static void locks_delete_block(struct file_lock *waiter)
  * the order they blocked. The documentation doesn't require this but
  * it seems like the reasonable thing to do.
  *
- * Must be called with both the i_lock and blocked_lock_lock held. The fl_block
- * list itself is protected by the blocked_lock_lock, but by ensuring that the
- * i_lock is also held on insertions we can avoid taking the blocked_lock_lock
- * in some cases when we see that the fl_block list is empty.
+ * Must be called with both the i_lock and the inode's blocked list lock
+ * held, and also with blocked_lock_lock if the blocker is a classic POSIX
+ * lock, since the waiter then goes into the blocked_hash.
  */
 static void __locks_insert_block(struct file_lock *blocker,
 					struct file_lock *waiter)
@@ -556,13 +573,15 @@ static void __locks_insert_block(struct file_lock *blocker,
 		locks_insert_global_blocked(waiter);
 }
 
-/* Must be called with i_lock held. */
-static void locks_insert_block(struct file_lock *blocker,
+/* Must be called with i_lock held, and not for classic POSIX blockers. */
+static void locks_insert_block(struct inode *inode, struct file_lock *blocker,
 					struct file_lock *waiter)
 {
-	spin_lock(&blocked_lock_lock);
+	spinlock_t *lock = blocked_list_lock(inode);
+
+	spin_lock(lock);
 	__locks_insert_block(blocker, waiter);
-	spin_unlock(&blocked_lock_lock);
+	spin_unlock(lock);
 }
 
 /*
@@ -572,17 +591,20 @@ static void locks_insert_block(struct file_lock *blocker,
  */
 static void locks_wake_up_blocks(struct file_lock *blocker)
 {
+	spinlock_t *lock;
+
 	/*
-	 * Avoid taking global lock if list is empty. This is safe since new
+	 * Avoid taking the list lock if list is empty. This is safe since new
 	 * blocked requests are only added to the list under the i_lock, and
 	 * the i_lock is always held here. Note that removal from the fl_block
 	 * list does not require the i_lock, so we must recheck list_empty()
-	 * after acquiring the blocked_lock_lock.
+	 * after acquiring the list lock.
 	 */
 	if (list_empty(&blocker->fl_block))
 		return;
 
-	spin_lock(&blocked_lock_lock);
+	lock = blocked_list_lock(file_inode(blocker->fl_file));
+	spin_lock(lock);
 	while (!list_empty(&blocker->fl_block)) {
 		struct file_lock *waiter;
 
@@ -594,7 +616,7 @@ static void locks_wake_up_blocks(struct file_lock *blocker)
 		else
 			wake_up(&waiter->fl_wait);
 	}
-	spin_unlock(&blocked_lock_lock);
+	spin_unlock(lock);
 }
 
 /* Insert file lock fl into an inode's lock list at the position indicated
@@ -862,7 +884,7 @@ find_conflict:
 		if (!(request->fl_flags & FL_SLEEP))
 			goto out;
 		error = FILE_LOCK_DEFERRED;
-		locks_insert_block(fl, request);
+		locks_insert_block(inode, fl, request);
 		goto out;
 	}
 	if (request->fl_flags & FL_ACCESS)
@@ -924,14 +946,24 @@ static int __posix_lock_file(struct inode *inode, struct file_lock *request, str
 			/*
 			 * Deadlock detection and insertion into the blocked
 			 * locks list must be done while holding the same lock!
+			 * An OFD request blocked by an OFD lock neither takes
+			 * part in deadlock detection nor goes into the
+			 * blocked_hash, so it only needs the list lock.
 			 */
 			error = -EDEADLK;
-			spin_lock(&blocked_lock_lock);
-			if (likely(!posix_locks_deadlock(request, fl))) {
+			spin_lock(blocked_list_lock(inode));
+			if (IS_OFDLCK(request) && IS_OFDLCK(fl)) {
 				error = FILE_LOCK_DEFERRED;
 				__locks_insert_block(fl, request);
+			} else {
+				spin_lock(&blocked_lock_lock);
+				if (likely(!posix_locks_deadlock(request, fl))) {
+					error = FILE_LOCK_DEFERRED;
+					__locks_insert_block(fl, request);
+				}
+				spin_unlock(&blocked_lock_lock);
 			}
-			spin_unlock(&blocked_lock_lock);
+			spin_unlock(blocked_list_lock(inode));
 			goto out;
   		}
   	}
@@ -1134,7 +1166,7 @@ int posix_lock_file_wait(struct file *filp, struct file_lock *fl)
 		if (!error)
 			continue;
 
-		locks_delete_block(fl);
+		locks_delete_block(file_inode(filp), fl);
 		break;
 	}
 	return error;
@@ -1224,7 +1256,7 @@ int locks_mandatory_area(int read_write, struct inode *inode,
 				continue;
 		}
 
-		locks_delete_block(&fl);
+		locks_delete_block(inode, &fl);
 		break;
 	}
 
@@ -1383,12 +1415,12 @@ restart:
 		break_time -= jiffies;
 	if (break_time == 0)
 		break_time++;
-	locks_insert_block(flock, new_fl);
+	locks_insert_block(inode, flock, new_fl);
 	spin_unlock(&inode->i_lock);
 	error = wait_event_interruptible_timeout(new_fl->fl_wait,
 						!new_fl->fl_next, break_time);
 	spin_lock(&inode->i_lock);
-	locks_delete_block(new_fl);
+	locks_delete_block(inode, new_fl);
 	if (error >= 0) {
 		if (error == 0)
 			time_out_leases(inode);
@@ -1787,7 +1819,7 @@ int flock_lock_file_wait(struct file *filp, struct file_lock *fl)
 		if (!error)
 			continue;
 
-		locks_delete_block(fl);
+		locks_delete_block(file_inode(filp), fl);
 		break;
 	}
 	return error;
@@ -2015,7 +2047,7 @@ static int do_lock_file_wait(struct file *filp, unsigned int cmd,
 		if (!error)
 			continue;
 
-		locks_delete_block(fl);
+		locks_delete_block(file_inode(filp), fl);
 		break;
 	}
 
@@ -2369,14 +2401,15 @@ void locks_remove_file(struct file *filp)
 int
 posix_unblock_lock(struct file_lock *waiter)
 {
+	spinlock_t *lock = blocked_list_lock(file_inode(waiter->fl_file));
 	int status = 0;
 
-	spin_lock(&blocked_lock_lock);
+	spin_lock(lock);
 	if (waiter->fl_next)
 		__locks_delete_block(waiter);
 	else
 		status = -ENOENT;
-	spin_unlock(&blocked_lock_lock);
+	spin_unlock(lock);
 	return status;
 }
 EXPORT_SYMBOL(posix_unblock_lock);
@@ -2492,20 +2525,24 @@ static int locks_show(struct seq_file *f, void *v)
 
 	lock_get_status(f, fl, iter->li_pos, "");
 
-	list_for_each_entry(bfl, &fl->fl_block, fl_block)
-		lock_get_status(f, bfl, iter->li_pos, " ->");
+	if (fl->fl_file) {
+		spinlock_t *lock = blocked_list_lock(file_inode(fl->fl_file));
+
+		spin_lock(lock);
+		list_for_each_entry(bfl, &fl->fl_block, fl_block)
+			lock_get_status(f, bfl, iter->li_pos, " ->");
+		spin_unlock(lock);
+	}
 
 	return 0;
 }
 
 static void *locks_start(struct seq_file *f, loff_t *pos)
-	__acquires(&blocked_lock_lock)
 {
 	struct locks_iterator *iter = f->private;
 
 	iter->li_pos = *pos + 1;
 	lg_global_lock(&file_lock_lglock);
-	spin_lock(&blocked_lock_lock);
 	return seq_hlist_start_percpu(&file_lock_list, &iter->li_cpu, *pos);
 }
 
@@ -2518,9 +2555,7 @@ static void *locks_next(struct seq_file *f, void *v, loff_t *pos)
 }
 
 static void locks_stop(struct seq_file *f, void *v)
-	__releases(&blocked_lock_lock)
 {
-	spin_unlock(&blocked_lock_lock);
 	lg_global_unlock(&file_lock_lglock);
 }
 
@@ -2644,6 +2679,9 @@ static int __init filelock_init(void)
 	for_each_possible_cpu(i)
 		INIT_HLIST_HEAD(per_cpu_ptr(&file_lock_list, i));
 
+	for (i = 0; i < ARRAY_SIZE(blocked_list_locks); i++)
+		spin_lock_init(&blocked_list_locks[i]);
+
 	return 0;
 }
 
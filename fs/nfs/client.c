@@ -779,6 +779,8 @@ static int nfs_init_server(struct nfs_server *server,
 	server->acregmax = data->acregmax * HZ;
 	server->acdirmin = data->acdirmin * HZ;
 	server->acdirmax = data->acdirmax * HZ;
+	server->dio_rpcs = data->dio_rpcs;
+	server->dio_commit = data->dio_commit;
 
 	/* Start lockd here, before we might error out */
 	error = nfs_start_lockd(server);
@@ -928,6 +930,8 @@ void nfs_server_copy_userdata(struct nfs_server *target, struct nfs_server *sour
 	target->acregmax = source->acregmax;
 	target->acdirmin = source->acdirmin;
 	target->acdirmax = source->acdirmax;
+	target->dio_rpcs = source->dio_rpcs;
+	target->dio_commit = source->dio_commit;
 	target->caps = source->caps;
 	target->options = source->options;
 	target->auth_info = source->auth_info;
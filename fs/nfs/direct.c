@@ -83,6 +83,11 @@ struct nfs_direct_req {
 				error;		/* any reported error */
 	struct completion	completion;	/* wait for i/o completion */
 
+	/* throttling state */
+	atomic_t		rpcs_inflight;	/* READs/WRITEs on the wire */
+	unsigned int		max_rpcs;	/* "dio_rpcs=" limit, 0 for none */
+	wait_queue_head_t	rpc_wait;	/* wait for rpcs_inflight to drop */
+
 	/* commit state */
 	struct nfs_mds_commit_info mds_cinfo;	/* Storage for cinfo */
 	struct pnfs_ds_commit_info ds_cinfo;	/* Storage for cinfo */
@@ -91,12 +96,17 @@ struct nfs_direct_req {
 #define NFS_ODIRECT_DO_COMMIT		(1)	/* an unstable reply was received */
 #define NFS_ODIRECT_RESCHED_WRITES	(2)	/* write verification failed */
 	struct nfs_writeverf	verf;		/* unstable write verifier */
+	size_t			commit_bytes;	/* unstable bytes not yet committing */
+	size_t			commit_batch;	/* send an early COMMIT after this */
+	bool			early_commit;	/* early COMMIT batch in progress */
+	struct work_struct	commit_work;
 };
 
 static const struct nfs_pgio_completion_ops nfs_direct_write_completion_ops;
 static const struct nfs_commit_completion_ops nfs_direct_commit_completion_ops;
 static void nfs_direct_write_complete(struct nfs_direct_req *dreq, struct inode *inode);
 static void nfs_direct_write_schedule_work(struct work_struct *work);
+static void nfs_direct_commit_work(struct work_struct *work);
 
 static inline void get_dreq(struct nfs_direct_req *dreq)
 {
@@ -169,6 +179,8 @@ static inline struct nfs_direct_req *nfs_direct_req_alloc(void)
 	init_completion(&dreq->completion);
 	INIT_LIST_HEAD(&dreq->mds_cinfo.list);
 	INIT_WORK(&dreq->work, nfs_direct_write_schedule_work);
+	INIT_WORK(&dreq->commit_work, nfs_direct_commit_work);
+	init_waitqueue_head(&dreq->rpc_wait);
 	spin_lock_init(&dreq->lock);
 
 	return dreq;
@@ -252,6 +264,29 @@ static void nfs_direct_complete(struct nfs_direct_req *dreq, bool write)
 	nfs_direct_req_release(dreq);
 }
 
+/*
+ * Hold off sending more READs or WRITEs for this request until fewer than
+ * the mount's "dio_rpcs=" limit are outstanding.  The limit is approximate,
+ * since a single wsize'd chunk may turn into more than one RPC.
+ */
+static void nfs_direct_throttle(struct nfs_direct_req *dreq)
+{
+	if (dreq->max_rpcs)
+		wait_event(dreq->rpc_wait,
+			   atomic_read(&dreq->rpcs_inflight) < dreq->max_rpcs);
+}
+
+/*
+ * Note that a READ or WRITE has finished.  The caller still holds its
+ * io_count reference, so the dreq can't go away under the wake up.
+ */
+static void nfs_direct_rpc_done(struct nfs_direct_req *dreq)
+{
+	atomic_dec(&dreq->rpcs_inflight);
+	if (dreq->max_rpcs)
+		wake_up(&dreq->rpc_wait);
+}
+
 static void nfs_direct_readpage_release(struct nfs_page *req)
 {
 	dprintk("NFS: direct read done (%s/%llu %d@%lld)\n",
@@ -288,6 +323,7 @@ static void nfs_direct_read_completion(struct nfs_pgio_header *hdr)
 		nfs_direct_readpage_release(req);
 	}
 out_put:
+	nfs_direct_rpc_done(dreq);
 	if (put_dreq(dreq))
 		nfs_direct_complete(dreq, false);
 	hdr->release(hdr);
@@ -307,6 +343,7 @@ static void nfs_read_sync_pgio_error(struct list_head *head)
 static void nfs_direct_pgio_init(struct nfs_pgio_header *hdr)
 {
 	get_dreq(hdr->dreq);
+	atomic_inc(&hdr->dreq->rpcs_inflight);
 }
 
 static const struct nfs_pgio_completion_ops nfs_direct_read_completion_ops = {
@@ -342,6 +379,8 @@ static ssize_t nfs_direct_read_schedule_segment(struct nfs_pageio_descriptor *de
 		size_t bytes;
 		int i;
 
+		nfs_direct_throttle(dreq);
+
 		pgbase = user_addr & ~PAGE_MASK;
 		bytes = min(max_t(size_t, rsize, PAGE_SIZE), count);
 
@@ -513,6 +552,7 @@ ssize_t nfs_file_direct_read(struct kiocb *iocb, const struct iovec *iov,
 		goto out_unlock;
 
 	dreq->inode = inode;
+	dreq->max_rpcs = NFS_SERVER(inode)->dio_rpcs;
 	dreq->bytes_left = iov_length(iov, nr_segs);
 	dreq->ctx = get_nfs_open_context(nfs_file_open_context(iocb->ki_filp));
 	l_ctx = nfs_get_lock_context(dreq->ctx);
@@ -561,7 +601,10 @@ static void nfs_direct_write_reschedule(struct nfs_direct_req *dreq)
 	nfs_scan_commit_list(&cinfo.mds->list, &reqs, &cinfo, 0);
 	spin_unlock(cinfo.lock);
 
-	dreq->count = 0;
+	/* only the writes being resent are uncounted; anything committed by an
+	 * earlier pipelined COMMIT is already safe on the server */
+	list_for_each_entry(req, &reqs, wb_list)
+		dreq->count -= req->wb_bytes;
 	get_dreq(dreq);
 
 	NFS_PROTO(dreq->inode)->write_pageio_init(&desc, dreq->inode, FLUSH_STABLE,
@@ -591,6 +634,24 @@ static void nfs_direct_write_reschedule(struct nfs_direct_req *dreq)
 		nfs_direct_write_complete(dreq, dreq->inode);
 }
 
+/*
+ * Called once all the COMMITs of a batch have returned.  The final COMMIT
+ * goes back to the write completion state machine; a pipelined one just
+ * drops the io_count reference it was holding.
+ */
+static void nfs_direct_commit_done(struct nfs_direct_req *dreq)
+{
+	bool early;
+
+	spin_lock(&dreq->lock);
+	early = dreq->early_commit;
+	dreq->early_commit = false;
+	spin_unlock(&dreq->lock);
+
+	if (!early || put_dreq(dreq))
+		nfs_direct_write_complete(dreq, dreq->inode);
+}
+
 static void nfs_direct_commit_complete(struct nfs_commit_data *data)
 {
 	struct nfs_direct_req *dreq = data->dreq;
@@ -599,6 +660,8 @@ static void nfs_direct_commit_complete(struct nfs_commit_data *data)
 	int status = data->task.tk_status;
 
 	nfs_init_cinfo_from_dreq(&cinfo, dreq);
+	/* WRITEs may still be completing if this is a pipelined COMMIT */
+	spin_lock(&dreq->lock);
 	if (status < 0) {
 		dprintk("NFS: %5u commit failed with error %d.\n",
 			data->task.tk_pid, status);
@@ -607,6 +670,7 @@ static void nfs_direct_commit_complete(struct nfs_commit_data *data)
 		dprintk("NFS: %5u commit verify failed\n", data->task.tk_pid);
 		dreq->flags = NFS_ODIRECT_RESCHED_WRITES;
 	}
+	spin_unlock(&dreq->lock);
 
 	dprintk("NFS: %5u commit returned %d\n", data->task.tk_pid, status);
 	while (!list_empty(&data->pages)) {
@@ -621,7 +685,7 @@ static void nfs_direct_commit_complete(struct nfs_commit_data *data)
 	}
 
 	if (atomic_dec_and_test(&cinfo.mds->rpcs_out))
-		nfs_direct_write_complete(dreq, data->inode);
+		nfs_direct_commit_done(dreq);
 }
 
 static void nfs_direct_error_cleanup(struct nfs_inode *nfsi)
@@ -634,6 +698,11 @@ static const struct nfs_commit_completion_ops nfs_direct_commit_completion_ops =
 	.error_cleanup = nfs_direct_error_cleanup,
 };
 
+/*
+ * Send COMMITs for the unstable writes collected so far.  We hold a count
+ * on rpcs_out while they go out, so that the batch can't be seen to finish
+ * before the last of them has been sent.
+ */
 static void nfs_direct_commit_schedule(struct nfs_direct_req *dreq)
 {
 	int res;
@@ -641,10 +710,47 @@ static void nfs_direct_commit_schedule(struct nfs_direct_req *dreq)
 	LIST_HEAD(mds_list);
 
 	nfs_init_cinfo_from_dreq(&cinfo, dreq);
-	nfs_scan_commit(dreq->inode, &mds_list, &cinfo);
-	res = nfs_generic_commit_list(dreq->inode, &mds_list, 0, &cinfo);
-	if (res < 0) /* res == -ENOMEM */
-		nfs_direct_write_reschedule(dreq);
+	atomic_inc(&cinfo.mds->rpcs_out);
+	if (nfs_scan_commit(dreq->inode, &mds_list, &cinfo)) {
+		res = nfs_generic_commit_list(dreq->inode, &mds_list, 0,
+					      &cinfo);
+		/* res == -ENOMEM: the requests are back on the commit list;
+		 * a pipelined COMMIT leaves them for the final one, which
+		 * falls back to resending them stably */
+		if (res < 0 && !dreq->early_commit) {
+			spin_lock(&dreq->lock);
+			dreq->flags = NFS_ODIRECT_RESCHED_WRITES;
+			spin_unlock(&dreq->lock);
+		}
+	}
+	if (atomic_dec_and_test(&cinfo.mds->rpcs_out))
+		nfs_direct_commit_done(dreq);
+}
+
+/*
+ * Account for unstable bytes that have just been written and decide whether
+ * it's time to COMMIT them while later WRITEs are still going out.  Called
+ * with dreq->lock held by a WRITE completion, whose io_count reference keeps
+ * the dreq from completing before the reference for the COMMIT is taken.
+ */
+static bool nfs_direct_want_commit(struct nfs_direct_req *dreq, size_t bytes)
+{
+	dreq->commit_bytes += bytes;
+	if (!dreq->commit_batch || dreq->early_commit ||
+	    dreq->commit_bytes < dreq->commit_batch)
+		return false;
+
+	dreq->commit_bytes = 0;
+	dreq->early_commit = true;
+	get_dreq(dreq);
+	return true;
+}
+
+static void nfs_direct_commit_work(struct work_struct *work)
+{
+	struct nfs_direct_req *dreq = container_of(work, struct nfs_direct_req, commit_work);
+
+	nfs_direct_commit_schedule(dreq);
 }
 
 static void nfs_direct_write_schedule_work(struct work_struct *work)
@@ -675,6 +781,15 @@ static void nfs_direct_write_schedule_work(struct work_struct *work)
 {
 }
 
+static void nfs_direct_commit_work(struct work_struct *work)
+{
+}
+
+static bool nfs_direct_want_commit(struct nfs_direct_req *dreq, size_t bytes)
+{
+	return false;
+}
+
 static void nfs_direct_write_complete(struct nfs_direct_req *dreq, struct inode *inode)
 {
 	nfs_direct_complete(dreq, true);
@@ -712,6 +827,8 @@ static ssize_t nfs_direct_write_schedule_segment(struct nfs_pageio_descriptor *d
 		size_t bytes;
 		int i;
 
+		nfs_direct_throttle(dreq);
+
 		pgbase = user_addr & ~PAGE_MASK;
 		bytes = min(max_t(size_t, wsize, PAGE_SIZE), count);
 
@@ -788,6 +905,7 @@ static void nfs_direct_write_completion(struct nfs_pgio_header *hdr)
 {
 	struct nfs_direct_req *dreq = hdr->dreq;
 	struct nfs_commit_info cinfo;
+	bool commit = false;
 	int bit = -1;
 	struct nfs_page *req = nfs_list_entry(hdr->pages.next);
 
@@ -824,6 +942,9 @@ static void nfs_direct_write_completion(struct nfs_pgio_header *hdr)
 				} else
 					bit = NFS_IOHDR_NEED_COMMIT;
 			}
+			if (bit == NFS_IOHDR_NEED_COMMIT)
+				commit = nfs_direct_want_commit(dreq,
+							hdr->good_bytes);
 		}
 	}
 	spin_unlock(&dreq->lock);
@@ -840,7 +961,12 @@ static void nfs_direct_write_completion(struct nfs_pgio_header *hdr)
 		nfs_unlock_and_release_request(req);
 	}
 
+	/* COMMIT what we have so far while the remaining WRITEs go out */
+	if (commit)
+		schedule_work(&dreq->commit_work);
+
 out_put:
+	nfs_direct_rpc_done(dreq);
 	if (put_dreq(dreq))
 		nfs_direct_write_complete(dreq, hdr->inode);
 	hdr->release(hdr);
@@ -982,6 +1108,9 @@ ssize_t nfs_file_direct_write(struct kiocb *iocb, const struct iovec *iov,
 		goto out_unlock;
 
 	dreq->inode = inode;
+	dreq->max_rpcs = NFS_SERVER(inode)->dio_rpcs;
+	dreq->commit_batch = (size_t)NFS_SERVER(inode)->dio_commit *
+			     NFS_SERVER(inode)->wsize;
 	dreq->bytes_left = count;
 	dreq->ctx = get_nfs_open_context(nfs_file_open_context(iocb->ki_filp));
 	l_ctx = nfs_get_lock_context(dreq->ctx);
@@ -19,6 +19,12 @@ struct nfs_string;
  */
 #define NFS_MAX_READAHEAD	(RPC_DEF_SLOT_TABLE - 1)
 
+/* Number of wsize'd chunks of unstable O_DIRECT data that may accumulate
+ * before a COMMIT is sent for them while later WRITEs are still in flight
+ * ("dio_commit=" mount option, 0 commits only once all WRITEs are done)
+ */
+#define NFS_DEF_DIO_COMMIT	16
+
 static inline void nfs_attr_check_mountpoint(struct super_block *parent, struct nfs_fattr *fattr)
 {
 	if (!nfs_fsid_equal(&NFS_SB(parent)->fsid, &fattr->fsid))
@@ -88,6 +94,7 @@ struct nfs_parsed_mount_data {
 	unsigned int		namlen;
 	unsigned int		options;
 	unsigned int		bsize;
+	unsigned int		dio_rpcs, dio_commit;
 	struct nfs_auth_info	auth_info;
 	rpc_authflavor_t	selected_flavor;
 	char			*client_address;
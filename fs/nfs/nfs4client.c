@@ -1004,6 +1004,8 @@ static int nfs4_init_server(struct nfs_server *server,
 	server->acregmax = data->acregmax * HZ;
 	server->acdirmin = data->acdirmin * HZ;
 	server->acdirmax = data->acdirmax * HZ;
+	server->dio_rpcs = data->dio_rpcs;
+	server->dio_commit = data->dio_commit;
 
 	server->port = data->nfs_server.port;
 
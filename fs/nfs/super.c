@@ -103,6 +103,7 @@ enum {
 	Opt_mountport,
 	Opt_mountvers,
 	Opt_minorversion,
+	Opt_dio_rpcs, Opt_dio_commit,
 
 	/* Mount options that take string arguments */
 	Opt_nfsvers,
@@ -168,6 +169,8 @@ static const match_table_t nfs_mount_option_tokens = {
 	{ Opt_mountport, "mountport=%s" },
 	{ Opt_mountvers, "mountvers=%s" },
 	{ Opt_minorversion, "minorversion=%s" },
+	{ Opt_dio_rpcs, "dio_rpcs=%s" },
+	{ Opt_dio_commit, "dio_commit=%s" },
 
 	{ Opt_nfsvers, "nfsvers=%s" },
 	{ Opt_nfsvers, "vers=%s" },
@@ -659,6 +662,10 @@ static void nfs_show_mount_options(struct seq_file *m, struct nfs_server *nfss,
 		seq_printf(m, ",acdirmin=%u", nfss->acdirmin/HZ);
 	if (nfss->acdirmax != NFS_DEF_ACDIRMAX*HZ || showdefaults)
 		seq_printf(m, ",acdirmax=%u", nfss->acdirmax/HZ);
+	if (nfss->dio_rpcs != 0 || showdefaults)
+		seq_printf(m, ",dio_rpcs=%u", nfss->dio_rpcs);
+	if (nfss->dio_commit != NFS_DEF_DIO_COMMIT || showdefaults)
+		seq_printf(m, ",dio_commit=%u", nfss->dio_commit);
 	for (nfs_infop = nfs_info; nfs_infop->flag; nfs_infop++) {
 		if (nfss->flags & nfs_infop->flag)
 			seq_puts(m, nfs_infop->str);
@@ -921,6 +928,7 @@ static struct nfs_parsed_mount_data *nfs_alloc_parsed_mount_data(void)
 		data->acregmax		= NFS_DEF_ACREGMAX;
 		data->acdirmin		= NFS_DEF_ACDIRMIN;
 		data->acdirmax		= NFS_DEF_ACDIRMAX;
+		data->dio_commit	= NFS_DEF_DIO_COMMIT;
 		data->mount_server.port	= NFS_UNSPEC_PORT;
 		data->nfs_server.port	= NFS_UNSPEC_PORT;
 		data->nfs_server.protocol = XPRT_TRANSPORT_TCP;
@@ -1407,6 +1415,16 @@ static int nfs_parse_mount_options(char *raw,
 				goto out_invalid_value;
 			mnt->minorversion = option;
 			break;
+		case Opt_dio_rpcs:
+			if (nfs_get_option_ul(args, &option))
+				goto out_invalid_value;
+			mnt->dio_rpcs = option;
+			break;
+		case Opt_dio_commit:
+			if (nfs_get_option_ul(args, &option))
+				goto out_invalid_value;
+			mnt->dio_commit = option;
+			break;
 
 		/*
 		 * options that take text values
@@ -2384,6 +2402,10 @@ static int nfs_compare_mount_options(const struct super_block *s, const struct n
 		goto Ebusy;
 	if (a->acdirmax != b->acdirmax)
 		goto Ebusy;
+	if (a->dio_rpcs != b->dio_rpcs)
+		goto Ebusy;
+	if (a->dio_commit != b->dio_commit)
+		goto Ebusy;
 	if (b->auth_info.flavor_len > 0 &&
 	   clnt_a->cl_auth->au_flavor != clnt_b->cl_auth->au_flavor)
 		goto Ebusy;
@@ -18,7 +18,6 @@
  * is much larger than a sockaddr_in6.
  */
 struct svc_cacherep {
-	struct hlist_node	c_hash;
 	struct list_head	c_lru;
 
 	unsigned char		c_state,	/* unused, inprog, done */
@@ -78,10 +77,19 @@ enum {
 /* Checksum this amount of the request */
 #define RC_CSUMLEN		(256U)
 
+/* reply cache counters, kept per-cpu and summed on demand */
+struct nfsd_drc_stats {
+	unsigned int		hits;
+	unsigned int		misses;
+	unsigned int		nocache;
+	unsigned int		payload_misses;
+};
+
 int	nfsd_reply_cache_init(void);
 void	nfsd_reply_cache_shutdown(void);
 int	nfsd_cache_lookup(struct svc_rqst *);
 void	nfsd_cache_update(struct svc_rqst *, int, __be32 *);
 int	nfsd_reply_cache_stats_open(struct inode *, struct file *);
+void	nfsd_reply_cache_stats(struct nfsd_drc_stats *);
 
 #endif /* NFSCACHE_H */
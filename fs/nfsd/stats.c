@@ -28,6 +28,7 @@
 #include <net/net_namespace.h>
 
 #include "nfsd.h"
+#include "cache.h"
 
 struct nfsd_stats	nfsdstats;
 struct svc_stat		nfsd_svcstats = {
@@ -36,12 +37,14 @@ struct svc_stat		nfsd_svcstats = {
 
 static int nfsd_proc_show(struct seq_file *seq, void *v)
 {
+	struct nfsd_drc_stats rc;
 	int i;
 
+	nfsd_reply_cache_stats(&rc);
 	seq_printf(seq, "rc %u %u %u\nfh %u %u %u %u %u\nio %u %u\n",
-		      nfsdstats.rchits,
-		      nfsdstats.rcmisses,
-		      nfsdstats.rcnocache,
+		      rc.hits,
+		      rc.misses,
+		      rc.nocache,
 		      nfsdstats.fh_stale,
 		      nfsdstats.fh_lookup,
 		      nfsdstats.fh_anon,
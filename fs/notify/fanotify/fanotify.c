@@ -11,6 +11,9 @@
 
 #include "fanotify.h"
 
+/* how many of the most recently queued events to try merging with */
+#define FANOTIFY_MERGE_DEPTH	128
+
 static bool should_merge(struct fsnotify_event *old_fsn,
 			 struct fsnotify_event *new_fsn)
 {
@@ -32,6 +35,7 @@ static int fanotify_merge(struct list_head *list, struct fsnotify_event *event)
 {
 	struct fsnotify_event *test_event;
 	bool do_merge = false;
+	int depth = 0;
 
 	pr_debug("%s: list=%p event=%p\n", __func__, list, event);
 
@@ -45,11 +49,17 @@ static int fanotify_merge(struct list_head *list, struct fsnotify_event *event)
 		return 0;
 #endif
 
+	/*
+	 * Only look at the most recent events: scanning the whole queue made
+	 * every new event O(queue length) under the notification_mutex.
+	 */
 	list_for_each_entry_reverse(test_event, list, list) {
 		if (should_merge(test_event, event)) {
 			do_merge = true;
 			break;
 		}
+		if (++depth >= FANOTIFY_MERGE_DEPTH)
+			break;
 	}
 
 	if (!do_merge)
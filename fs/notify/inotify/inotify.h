@@ -6,10 +6,19 @@ struct inotify_event_info {
 	struct fsnotify_event fse;
 	int wd;
 	u32 sync_cookie;
+	unsigned long stamp;	/* jiffies when queued, for merging */
 	int name_len;
 	char name[];
 };
 
+/*
+ * Repeated IN_MODIFY/IN_ACCESS events for the same object are coalesced if
+ * the previous one is among the last INOTIFY_MERGE_DEPTH queued events and
+ * was queued less than INOTIFY_MERGE_WINDOW ago.
+ */
+#define INOTIFY_MERGE_DEPTH	64
+#define INOTIFY_MERGE_WINDOW	(HZ / 10)
+
 struct inotify_inode_mark {
 	struct fsnotify_mark fsn_mark;
 	int wd;
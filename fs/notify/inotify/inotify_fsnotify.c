@@ -30,6 +30,7 @@
 #include <linux/slab.h> /* kmem_* */
 #include <linux/types.h>
 #include <linux/sched.h>
+#include <linux/jiffies.h>
 
 #include "inotify.h"
 
@@ -53,13 +54,48 @@ static bool event_compare(struct fsnotify_event *old_fsn,
 	return false;
 }
 
+/*
+ * Check if 2 events are about the same watched object (the watch itself or
+ * the same child of a watched directory).
+ */
+static bool event_same_object(struct inotify_event_info *old,
+			      struct inotify_event_info *new)
+{
+	return old->wd == new->wd && old->name_len == new->name_len &&
+	       (!old->name_len || !strcmp(old->name, new->name));
+}
+
 static int inotify_merge(struct list_head *list,
 			  struct fsnotify_event *event)
 {
+	struct inotify_event_info *old, *new = INOTIFY_E(event);
 	struct fsnotify_event *last_event;
+	int depth = 0;
 
 	last_event = list_entry(list->prev, struct fsnotify_event, list);
-	return event_compare(last_event, event);
+	if (event_compare(last_event, event))
+		return 1;
+
+	/*
+	 * Data events may also be folded into an identical earlier one, as
+	 * long as nothing else happened to the same object in between, so
+	 * that ordering with respect to e.g. IN_CLOSE_WRITE is preserved.
+	 */
+	if (event->mask & ~(IN_MODIFY | IN_ACCESS | IN_ISDIR |
+			    FS_EVENT_ON_CHILD))
+		return 0;
+
+	list_for_each_entry_reverse(last_event, list, list) {
+		if (++depth > INOTIFY_MERGE_DEPTH ||
+		    last_event->mask == FS_Q_OVERFLOW)
+			break;
+		old = INOTIFY_E(last_event);
+		if (time_after(new->stamp, old->stamp + INOTIFY_MERGE_WINDOW))
+			break;
+		if (event_same_object(old, new))
+			return event_compare(last_event, event);
+	}
+	return 0;
 }
 
 int inotify_handle_event(struct fsnotify_group *group,
@@ -104,6 +140,7 @@ int inotify_handle_event(struct fsnotify_group *group,
 	fsnotify_init_event(fsn_event, inode, mask);
 	event->wd = i_mark->wd;
 	event->sync_cookie = cookie;
+	event->stamp = jiffies;
 	event->name_len = len;
 	if (len)
 		strcpy(event->name, file_name);
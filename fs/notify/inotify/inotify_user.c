@@ -220,13 +220,18 @@ static ssize_t copy_event_to_user(struct fsnotify_group *group,
 	return event_size;
 }
 
+/* number of events dequeued per notification_mutex hold in inotify_read() */
+#define INOTIFY_READ_BATCH	16
+
 static ssize_t inotify_read(struct file *file, char __user *buf,
 			    size_t count, loff_t *pos)
 {
 	struct fsnotify_group *group;
 	struct fsnotify_event *kevent;
+	struct fsnotify_event *batch[INOTIFY_READ_BATCH];
 	char __user *start;
-	int ret;
+	size_t avail;
+	int ret, nr, i;
 	DEFINE_WAIT(wait);
 
 	start = buf;
@@ -235,23 +240,46 @@ static ssize_t inotify_read(struct file *file, char __user *buf,
 	while (1) {
 		prepare_to_wait(&group->notification_waitq, &wait, TASK_INTERRUPTIBLE);
 
+		/* pull off as many events as fit, under a single lock hold */
+		avail = count;
 		mutex_lock(&group->notification_mutex);
-		kevent = get_one_event(group, count);
+		for (nr = 0; nr < INOTIFY_READ_BATCH; nr++) {
+			kevent = get_one_event(group, avail);
+			if (IS_ERR_OR_NULL(kevent))
+				break;
+			avail -= sizeof(struct inotify_event) +
+				 round_event_name_len(kevent);
+			batch[nr] = kevent;
+		}
 		mutex_unlock(&group->notification_mutex);
 
-		pr_debug("%s: group=%p kevent=%p\n", __func__, group, kevent);
+		pr_debug("%s: group=%p nr=%d kevent=%p\n", __func__, group, nr,
+			 kevent);
+
+		if (nr) {
+			for (i = 0; i < nr; i++) {
+				ret = copy_event_to_user(group, batch[i], buf);
+				if (ret < 0)
+					break;
+				fsnotify_destroy_event(group, batch[i]);
+				buf += ret;
+				count -= ret;
+			}
+			if (i < nr) {
+				/* don't lose what we couldn't copy */
+				mutex_lock(&group->notification_mutex);
+				while (nr-- > i)
+					fsnotify_requeue_notify_event(group,
+								      batch[nr]);
+				mutex_unlock(&group->notification_mutex);
+				break;
+			}
+			continue;
+		}
 
 		if (kevent) {
 			ret = PTR_ERR(kevent);
-			if (IS_ERR(kevent))
-				break;
-			ret = copy_event_to_user(group, kevent, buf);
-			fsnotify_destroy_event(group, kevent);
-			if (ret < 0)
-				break;
-			buf += ret;
-			count -= ret;
-			continue;
+			break;
 		}
 
 		ret = -EAGAIN;
@@ -648,6 +676,7 @@ static struct fsnotify_group *inotify_new_group(unsigned int max_events)
 	fsnotify_init_event(group->overflow_event, NULL, FS_Q_OVERFLOW);
 	oevent->wd = -1;
 	oevent->sync_cookie = 0;
+	oevent->stamp = 0;
 	oevent->name_len = 0;
 
 	group->max_events = max_events;
@@ -148,6 +148,23 @@ struct fsnotify_event *fsnotify_remove_notify_event(struct fsnotify_group *group
 	return event;
 }
 
+/*
+ * Put an event obtained from fsnotify_remove_notify_event() back at the head
+ * of the notification list, for a reader that could not deliver it.
+ */
+void fsnotify_requeue_notify_event(struct fsnotify_group *group,
+				   struct fsnotify_event *event)
+{
+	BUG_ON(!mutex_is_locked(&group->notification_mutex));
+
+	/* The overflow event may have been queued again in the meantime */
+	if (!list_empty(&event->list))
+		return;
+
+	list_add(&event->list, &group->notification_list);
+	group->q_len++;
+}
+
 /*
  * This will not remove the event, that must be done with fsnotify_remove_notify_event()
  */
@@ -151,6 +151,12 @@ static inline const char *get_task_state(struct task_struct *tsk)
 	return task_state_array[fls(state)];
 }
 
+/* the state letter, as shown in /proc/<pid>/stat */
+char proc_task_state_char(struct task_struct *tsk)
+{
+	return get_task_state(tsk)[0];
+}
+
 static inline void task_state(struct seq_file *m, struct pid_namespace *ns,
 				struct pid *pid, struct task_struct *p)
 {
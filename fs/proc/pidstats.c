@@ -0,0 +1,249 @@
+/*
+ *  linux/fs/proc/pidstats.c
+ *
+ *  Bulk, binary per-process statistics, see include/uapi/linux/pidstats.h.
+ *
+ *  Monitoring agents that sample /proc/<pid>/{stat,status,io} for every
+ *  process pay for a lookup, a seq_file and text formatting per file and
+ *  per process.  A read of /proc/pidstats fills the user buffer with as
+ *  many fixed-size records as fit instead.
+ */
+
+#include <linux/fs.h>
+#include <linux/init.h>
+#include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/pid_namespace.h>
+#include <linux/proc_fs.h>
+#include <linux/ptrace.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/cred.h>
+#include <linux/cputime.h>
+#include <linux/task_io_accounting_ops.h>
+#include <linux/uaccess.h>
+#include <linux/pidstats.h>
+
+#include "internal.h"
+
+struct pidstats_file {
+	struct mutex	lock;
+	bool		changed_only;
+	u64		since;		/* start of the last complete pass */
+	u64		pass_start;	/* start of the pass in progress */
+};
+
+/*
+ * Has any thread of the group been on a cpu since @since?  last_arrival is
+ * taken from the runqueue clock, so this is only as precise as sched_clock
+ * is between cpus.  Without schedstats or delay accounting every task is
+ * considered changed.
+ */
+static bool pidstats_task_changed(struct task_struct *task, u64 since)
+{
+#if defined(CONFIG_SCHEDSTATS) || defined(CONFIG_TASK_DELAY_ACCT)
+	struct task_struct *t = task;
+
+	do {
+		if (t->sched_info.last_arrival >= since || task_curr(t))
+			return true;
+	} while_each_thread(task, t);
+	return false;
+#else
+	return true;
+#endif
+}
+
+static void pidstats_fill(struct pidstats *ps, struct task_struct *task,
+			  struct pid_namespace *ns,
+			  struct user_namespace *user_ns)
+{
+	struct task_io_accounting acct;
+	const struct cred *cred;
+	struct mm_struct *mm;
+	cputime_t utime = 0, stime = 0;
+	unsigned long flags;
+
+	memset(ps, 0, sizeof(*ps));
+	memset(&acct, 0, sizeof(acct));
+	ps->ps_size = sizeof(*ps);
+	ps->ps_pid = task_tgid_nr_ns(task, ns);
+	ps->ps_state = proc_task_state_char(task);
+	get_task_comm(ps->ps_comm, task);
+	ps->ps_start_time = timespec_to_ns(&task->real_start_time);
+
+	rcu_read_lock();
+	cred = __task_cred(task);
+	ps->ps_uid = from_kuid_munged(user_ns, cred->uid);
+	ps->ps_gid = from_kgid_munged(user_ns, cred->gid);
+	rcu_read_unlock();
+
+	if (lock_task_sighand(task, &flags)) {
+		struct signal_struct *sig = task->signal;
+		struct task_struct *t = task;
+
+		ps->ps_nr_threads = get_nr_threads(task);
+		ps->ps_ppid = task_tgid_nr_ns(task->real_parent, ns);
+		ps->ps_min_flt = sig->min_flt;
+		ps->ps_maj_flt = sig->maj_flt;
+		ps->ps_nvcsw = sig->nvcsw;
+		ps->ps_nivcsw = sig->nivcsw;
+		task_io_accounting_add(&acct, &sig->ioac);
+		do {
+			ps->ps_min_flt += t->min_flt;
+			ps->ps_maj_flt += t->maj_flt;
+			ps->ps_nvcsw += t->nvcsw;
+			ps->ps_nivcsw += t->nivcsw;
+			task_io_accounting_add(&acct, &t->ioac);
+		} while_each_thread(task, t);
+
+		thread_group_cputime_adjusted(task, &utime, &stime);
+		unlock_task_sighand(task, &flags);
+	}
+	ps->ps_utime = cputime_to_nsecs(utime);
+	ps->ps_stime = cputime_to_nsecs(stime);
+
+	mm = get_task_mm(task);
+	if (mm) {
+		ps->ps_vsize = task_vsize(mm);
+		ps->ps_rss = get_mm_rss(mm);
+		mmput(mm);
+	}
+
+#ifdef CONFIG_TASK_IO_ACCOUNTING
+	/* same rule as /proc/<pid>/io */
+	if (ptrace_may_access(task, PTRACE_MODE_READ | PTRACE_MODE_NOAUDIT)) {
+		ps->ps_flags |= PIDSTATS_F_IO;
+		ps->ps_rchar = acct.rchar;
+		ps->ps_wchar = acct.wchar;
+		ps->ps_syscr = acct.syscr;
+		ps->ps_syscw = acct.syscw;
+		ps->ps_read_bytes = acct.read_bytes;
+		ps->ps_write_bytes = acct.write_bytes;
+		ps->ps_cancelled_write_bytes = acct.cancelled_write_bytes;
+	}
+#endif
+}
+
+/*
+ * Find the next thread group leader at or after *nr that should be
+ * reported, and return it with a reference held.
+ */
+static struct task_struct *pidstats_next_task(struct pid_namespace *ns,
+					      pid_t *nr, u64 since,
+					      bool changed_only)
+{
+	struct task_struct *task;
+	struct pid *pid;
+
+	rcu_read_lock();
+	for (;;) {
+		pid = find_ge_pid(*nr, ns);
+		if (!pid) {
+			task = NULL;
+			break;
+		}
+		*nr = pid_nr_ns(pid, ns);
+		task = pid_task(pid, PIDTYPE_PID);
+		if (task && has_group_leader_pid(task) &&
+		    (!changed_only || pidstats_task_changed(task, since))) {
+			get_task_struct(task);
+			break;
+		}
+		(*nr)++;
+	}
+	rcu_read_unlock();
+	return task;
+}
+
+static ssize_t pidstats_read(struct file *file, char __user *buf,
+			     size_t count, loff_t *ppos)
+{
+	struct pid_namespace *ns = file_inode(file)->i_sb->s_fs_info;
+	struct pidstats_file *pf = file->private_data;
+	struct task_struct *task;
+	struct pidstats ps;
+	ssize_t done = 0;
+	pid_t nr;
+
+	if (count < sizeof(ps))
+		return -EINVAL;
+	if (*ppos < 0 || *ppos >= PID_MAX_LIMIT)
+		return 0;
+
+	mutex_lock(&pf->lock);
+	nr = *ppos;
+	if (nr == 0)
+		pf->pass_start = local_clock();
+
+	while (done + sizeof(ps) <= count) {
+		task = pidstats_next_task(ns, &nr, pf->since, pf->changed_only);
+		if (!task) {
+			/* end of this pass */
+			nr = PID_MAX_LIMIT;
+			pf->since = pf->pass_start;
+			break;
+		}
+		/* the whole record is per-pid content, so hidepid=1 hides it */
+		if (!has_pid_permissions(ns, task, 1)) {
+			put_task_struct(task);
+			nr++;
+			cond_resched();
+			continue;
+		}
+		pidstats_fill(&ps, task, ns, file->f_cred->user_ns);
+		put_task_struct(task);
+
+		if (copy_to_user(buf + done, &ps, sizeof(ps))) {
+			if (!done)
+				done = -EFAULT;
+			break;
+		}
+		done += sizeof(ps);
+		nr++;
+
+		if (fatal_signal_pending(current))
+			break;
+		cond_resched();
+	}
+	if (done >= 0)
+		*ppos = nr;
+	mutex_unlock(&pf->lock);
+
+	return done;
+}
+
+static int pidstats_open(struct inode *inode, struct file *file)
+{
+	struct pidstats_file *pf;
+
+	pf = kzalloc(sizeof(*pf), GFP_KERNEL);
+	if (!pf)
+		return -ENOMEM;
+	mutex_init(&pf->lock);
+	pf->changed_only = PDE_DATA(inode) != NULL;
+	file->private_data = pf;
+	return 0;
+}
+
+static int pidstats_release(struct inode *inode, struct file *file)
+{
+	kfree(file->private_data);
+	return 0;
+}
+
+static const struct file_operations pidstats_proc_fops = {
+	.open		= pidstats_open,
+	.read		= pidstats_read,
+	.llseek		= default_llseek,
+	.release	= pidstats_release,
+};
+
+static int __init proc_pidstats_init(void)
+{
+	proc_create_data("pidstats", S_IRUGO, NULL, &pidstats_proc_fops, NULL);
+	proc_create_data("pidstats_changed", S_IRUGO, NULL,
+			 &pidstats_proc_fops, (void *)1);
+	return 0;
+}
+fs_initcall(proc_pidstats_init);
@@ -47,6 +47,7 @@
 #include <linux/string.h>
 #include <linux/pagemap.h>
 #include <linux/mutex.h>
+#include <linux/workqueue.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -450,7 +451,7 @@ static int squashfs_readpage_sparse(struct page *page, int index, int file_end)
 	return 0;
 }
 
-static int squashfs_readpage(struct file *file, struct page *page)
+static int __squashfs_readpage(struct page *page)
 {
 	struct inode *inode = page->mapping->host;
 	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
@@ -498,6 +499,87 @@ out:
 }
 
 
+/*
+ * Readahead of whole Squashfs blocks.  A datablock is decompressed
+ * into every page it covers, so reading the first page of a block is
+ * enough.  Each block is handed to the per-superblock unbound
+ * workqueue (drained in squashfs_put_super()), which lets the
+ * following blocks be decompressed on other CPUs while the reader
+ * consumes the current one (subject to the decompressor allowing
+ * concurrent streams, see squashfs_max_decompressors()).
+ */
+struct squashfs_readahead_work {
+	struct work_struct	work;
+	struct inode		*inode;
+	pgoff_t			index;
+};
+
+static void squashfs_readahead_worker(struct work_struct *work)
+{
+	struct squashfs_readahead_work *ra = container_of(work,
+					struct squashfs_readahead_work, work);
+	struct address_space *mapping = ra->inode->i_mapping;
+	struct page *page;
+
+	page = find_or_create_page(mapping, ra->index,
+				mapping_gfp_mask(mapping) & ~__GFP_FS);
+	if (page) {
+		if (PageUptodate(page))
+			unlock_page(page);
+		else
+			__squashfs_readpage(page);
+		page_cache_release(page);
+	}
+
+	iput(ra->inode);
+	kfree(ra);
+}
+
+static void squashfs_readahead(struct inode *inode, int index)
+{
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	int shift = msblk->block_log - PAGE_CACHE_SHIFT;
+	int file_end = i_size_read(inode) >> msblk->block_log;
+	int last = min_t(int, index + msblk->readahead_blocks, file_end - 1);
+	struct squashfs_readahead_work *ra;
+	struct page *page;
+
+	for (index++; index <= last; index++) {
+		page = find_get_page(inode->i_mapping, (pgoff_t)index << shift);
+		if (page) {
+			page_cache_release(page);
+			continue;
+		}
+
+		ra = kmalloc(sizeof(*ra), GFP_NOFS);
+		if (ra == NULL)
+			break;
+
+		ra->inode = igrab(inode);
+		if (ra->inode == NULL) {
+			kfree(ra);
+			break;
+		}
+		ra->index = (pgoff_t)index << shift;
+		INIT_WORK(&ra->work, squashfs_readahead_worker);
+		queue_work(msblk->read_wq, &ra->work);
+	}
+}
+
+static int squashfs_readpage(struct file *file, struct page *page)
+{
+	struct inode *inode = page->mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	int shift = msblk->block_log - PAGE_CACHE_SHIFT;
+
+	if (msblk->readahead_blocks &&
+			(page->index & ((1 << shift) - 1)) == 0)
+		squashfs_readahead(inode, page->index >> shift);
+
+	return __squashfs_readpage(page);
+}
+
+
 const struct address_space_operations squashfs_aops = {
 	.readpage = squashfs_readpage
 };
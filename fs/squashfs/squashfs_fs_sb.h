@@ -28,7 +28,6 @@
 struct squashfs_cache {
 	char			*name;
 	int			entries;
-	int			curr_blk;
 	int			next_blk;
 	int			num_waiters;
 	int			unused;
@@ -37,10 +36,13 @@ struct squashfs_cache {
 	spinlock_t		lock;
 	wait_queue_head_t	wait_queue;
 	struct squashfs_cache_entry *entry;
+	struct hlist_head	*hash;
+	unsigned int		hash_bits;
 };
 
 struct squashfs_cache_entry {
 	u64			block;
+	struct hlist_node	hash_node;
 	int			length;
 	int			refcount;
 	u64			next_index;
@@ -76,5 +78,9 @@ struct squashfs_sb_info {
 	long long				bytes_used;
 	unsigned int				inodes;
 	int					xattr_ids;
+	unsigned int				fragment_cache_size;
+	unsigned int				metadata_cache_size;
+	unsigned int				readahead_blocks;
+	struct workqueue_struct			*read_wq;
 };
 #endif
@@ -36,6 +36,9 @@
 #include <linux/module.h>
 #include <linux/magic.h>
 #include <linux/xattr.h>
+#include <linux/parser.h>
+#include <linux/seq_file.h>
+#include <linux/workqueue.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -74,6 +77,73 @@ static const struct squashfs_decompressor *supported_squashfs_filesystem(short
 }
 
 
+enum {
+	Opt_fragment_cache, Opt_metadata_cache, Opt_readahead_blocks, Opt_err
+};
+
+static const match_table_t tokens = {
+	{Opt_fragment_cache, "fragment_cache=%u"},
+	{Opt_metadata_cache, "metadata_cache=%u"},
+	{Opt_readahead_blocks, "readahead_blocks=%u"},
+	{Opt_err, NULL}
+};
+
+#define SQUASHFS_MAX_CACHED_BLKS	1024
+#define SQUASHFS_MAX_READAHEAD		64
+
+/*
+ * Parse the (optional) cache sizing mount options.  Unknown options are
+ * ignored, as they always have been, so existing fstab entries keep working.
+ */
+static int squashfs_parse_options(struct squashfs_sb_info *msblk, char *options)
+{
+	substring_t args[MAX_OPT_ARGS];
+	char *p;
+	int option;
+
+	msblk->fragment_cache_size = SQUASHFS_CACHED_FRAGMENTS;
+	msblk->metadata_cache_size = SQUASHFS_CACHED_BLKS;
+	msblk->readahead_blocks = 0;
+
+	if (!options)
+		return 0;
+
+	while ((p = strsep(&options, ",")) != NULL) {
+		if (!*p)
+			continue;
+
+		switch (match_token(p, tokens, args)) {
+		case Opt_fragment_cache:
+			if (match_int(&args[0], &option) || option < 1 ||
+					option > SQUASHFS_MAX_CACHED_BLKS)
+				goto invalid;
+			msblk->fragment_cache_size = option;
+			break;
+		case Opt_metadata_cache:
+			if (match_int(&args[0], &option) || option < 1 ||
+					option > SQUASHFS_MAX_CACHED_BLKS)
+				goto invalid;
+			msblk->metadata_cache_size = option;
+			break;
+		case Opt_readahead_blocks:
+			if (match_int(&args[0], &option) || option < 0 ||
+					option > SQUASHFS_MAX_READAHEAD)
+				goto invalid;
+			msblk->readahead_blocks = option;
+			break;
+		default:
+			break;
+		}
+	}
+
+	return 0;
+
+invalid:
+	ERROR("Invalid mount option \"%s\"\n", p);
+	return -EINVAL;
+}
+
+
 static int squashfs_fill_super(struct super_block *sb, void *data, int silent)
 {
 	struct squashfs_sb_info *msblk;
@@ -100,6 +170,10 @@ static int squashfs_fill_super(struct super_block *sb, void *data, int silent)
 
 	mutex_init(&msblk->meta_index_mutex);
 
+	err = squashfs_parse_options(msblk, data);
+	if (err)
+		goto failed_mount;
+
 	/*
 	 * msblk->bytes_used is checked in squashfs_read_table to ensure reads
 	 * are not beyond filesystem end.  But as we're using
@@ -200,18 +274,33 @@ static int squashfs_fill_super(struct super_block *sb, void *data, int silent)
 	err = -ENOMEM;
 
 	msblk->block_cache = squashfs_cache_init("metadata",
-			SQUASHFS_CACHED_BLKS, SQUASHFS_METADATA_SIZE);
+			msblk->metadata_cache_size, SQUASHFS_METADATA_SIZE);
 	if (msblk->block_cache == NULL)
 		goto failed_mount;
 
-	/* Allocate read_page block */
+	/*
+	 * Allocate read_page block.  Readahead decompresses blocks in
+	 * parallel, so give each in-flight readahead block its own entry.
+	 */
 	msblk->read_page = squashfs_cache_init("data",
-		squashfs_max_decompressors(), msblk->block_size);
+		squashfs_max_decompressors() + msblk->readahead_blocks,
+		msblk->block_size);
 	if (msblk->read_page == NULL) {
 		ERROR("Failed to allocate read_page block\n");
 		goto failed_mount;
 	}
 
+	/*
+	 * Readahead workers hold inode references and use the caches, so
+	 * they get their own workqueue which put_super drains first.
+	 */
+	if (msblk->readahead_blocks) {
+		msblk->read_wq = alloc_workqueue("squashfs_%s", WQ_UNBOUND, 0,
+						sb->s_id);
+		if (msblk->read_wq == NULL)
+			goto failed_mount;
+	}
+
 	msblk->stream = squashfs_decompressor_setup(sb, flags);
 	if (IS_ERR(msblk->stream)) {
 		err = PTR_ERR(msblk->stream);
@@ -276,7 +365,7 @@ handle_fragments:
 		goto check_directory_table;
 
 	msblk->fragment_cache = squashfs_cache_init("fragment",
-		SQUASHFS_CACHED_FRAGMENTS, msblk->block_size);
+		msblk->fragment_cache_size, msblk->block_size);
 	if (msblk->fragment_cache == NULL) {
 		err = -ENOMEM;
 		goto failed_mount;
@@ -333,6 +422,8 @@ check_directory_table:
 	return 0;
 
 failed_mount:
+	if (msblk->read_wq)
+		destroy_workqueue(msblk->read_wq);
 	squashfs_cache_delete(msblk->block_cache);
 	squashfs_cache_delete(msblk->fragment_cache);
 	squashfs_cache_delete(msblk->read_page);
@@ -369,6 +460,23 @@ static int squashfs_statfs(struct dentry *dentry, struct kstatfs *buf)
 }
 
 
+static int squashfs_show_options(struct seq_file *seq, struct dentry *root)
+{
+	struct squashfs_sb_info *msblk = root->d_sb->s_fs_info;
+
+	if (msblk->fragment_cache_size != SQUASHFS_CACHED_FRAGMENTS)
+		seq_printf(seq, ",fragment_cache=%u",
+						msblk->fragment_cache_size);
+	if (msblk->metadata_cache_size != SQUASHFS_CACHED_BLKS)
+		seq_printf(seq, ",metadata_cache=%u",
+						msblk->metadata_cache_size);
+	if (msblk->readahead_blocks)
+		seq_printf(seq, ",readahead_blocks=%u",
+						msblk->readahead_blocks);
+	return 0;
+}
+
+
 static int squashfs_remount(struct super_block *sb, int *flags, char *data)
 {
 	sync_filesystem(sb);
@@ -381,6 +489,9 @@ static void squashfs_put_super(struct super_block *sb)
 {
 	if (sb->s_fs_info) {
 		struct squashfs_sb_info *sbi = sb->s_fs_info;
+		/* wait for readahead, which drops its inode references */
+		if (sbi->read_wq)
+			destroy_workqueue(sbi->read_wq);
 		squashfs_cache_delete(sbi->block_cache);
 		squashfs_cache_delete(sbi->fragment_cache);
 		squashfs_cache_delete(sbi->read_page);
@@ -497,6 +608,7 @@ static const struct super_operations squashfs_super_ops = {
 	.destroy_inode = squashfs_destroy_inode,
 	.statfs = squashfs_statfs,
 	.put_super = squashfs_put_super,
+	.show_options = squashfs_show_options,
 	.remount_fs = squashfs_remount
 };
 
@@ -640,6 +640,9 @@
 #define INIT_CALLS_LEVEL(level)						\
 		VMLINUX_SYMBOL(__initcall##level##_start) = .;		\
 		*(.initcall##level##.init)				\
+		VMLINUX_SYMBOL(__initcall##level##a_start) = .;		\
+		*(.initcall##level##a.init)				\
+		VMLINUX_SYMBOL(__initcall##level##a_end) = .;		\
 		*(.initcall##level##s.init)				\
 
 #define INIT_CALLS							\
@@ -54,13 +54,17 @@ struct linux_binprm {
 #define BINPRM_FLAGS_EXECFD (1 << BINPRM_FLAGS_EXECFD_BIT)
 
 /* Function parameter for binfmt->coredump */
+struct coredump_zstream;
+
 struct coredump_params {
 	const siginfo_t *siginfo;
 	struct pt_regs *regs;
 	struct file *file;
 	unsigned long limit;
 	unsigned long mm_flags;
-	loff_t written;
+	loff_t written;		/* logical size of the dump so far */
+	loff_t stored;		/* bytes actually written to the file */
+	struct coredump_zstream *zs;
 };
 
 /*
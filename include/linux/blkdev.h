@@ -164,6 +164,9 @@ struct request {
 	unsigned long start_time;
 #ifdef CONFIG_BLK_CGROUP
 	struct request_list *rl;		/* rl this rq is alloced from */
+#endif
+#if defined(CONFIG_BLK_CGROUP) || defined(CONFIG_BLK_DEV_IO_TRACE)
+	/* for cfq group stats and blktrace latency aggregation */
 	unsigned long long start_time_ns;
 	unsigned long long io_start_time_ns;    /* when passed to hardware */
 #endif
@@ -1373,24 +1376,20 @@ struct work_struct;
 int kblockd_schedule_work(struct request_queue *q, struct work_struct *work);
 int kblockd_schedule_delayed_work(struct request_queue *q, struct delayed_work *dwork, unsigned long delay);
 
-#ifdef CONFIG_BLK_CGROUP
+#if defined(CONFIG_BLK_CGROUP) || defined(CONFIG_BLK_DEV_IO_TRACE)
 /*
- * This should not be using sched_clock(). A real patch is in progress
- * to fix this up, until that is in place we need to disable preemption
- * around sched_clock() in this function and set_io_start_time_ns().
+ * A request may be stamped on one CPU and completed on another, so use
+ * local_clock(), which unlike raw sched_clock() is kept consistent across
+ * CPUs, and compare against it only.
  */
 static inline void set_start_time_ns(struct request *req)
 {
-	preempt_disable();
-	req->start_time_ns = sched_clock();
-	preempt_enable();
+	req->start_time_ns = local_clock();
 }
 
 static inline void set_io_start_time_ns(struct request *req)
 {
-	preempt_disable();
-	req->io_start_time_ns = sched_clock();
-	preempt_enable();
+	req->io_start_time_ns = local_clock();
 }
 
 static inline uint64_t rq_start_time_ns(struct request *req)
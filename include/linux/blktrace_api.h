@@ -11,6 +11,8 @@
 
 #include <linux/sysfs.h>
 
+struct blk_trace_lat;
+
 struct blk_trace {
 	int trace_state;
 	struct rchan *rchan;
@@ -26,6 +28,17 @@ struct blk_trace {
 	struct dentry *msg_file;
 	struct list_head running_list;
 	atomic_t dropped;
+	/*
+	 * Aggregation mode: only keep per-cpu latency histograms instead of
+	 * emitting a record per event. lat[lat_idx] is the live generation,
+	 * the other one is being read out by a snapshot.
+	 */
+	u32 aggregate;
+	unsigned int lat_idx;
+	struct blk_trace_lat __percpu *lat[2];
+	struct mutex lat_mutex;
+	struct dentry *aggregate_file;
+	struct dentry *latency_file;
 };
 
 extern int blk_trace_ioctl(struct block_device *, unsigned, char __user *);
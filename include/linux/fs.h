@@ -2472,6 +2472,9 @@ enum {
 
 	/* filesystem can handle aio writes beyond i_size */
 	DIO_ASYNC_EXTEND = 0x04,
+
+	/* get_block never allocates for writes, so it may be used to look up */
+	DIO_LOOKUP_ONLY	= 0x08,
 };
 
 void dio_end_io(struct bio *bio, int error);
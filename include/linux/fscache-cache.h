@@ -151,6 +151,9 @@ struct fscache_retrieval {
 	void			*context;	/* netfs read context (pinned) */
 	struct list_head	to_do;		/* list of things to be done by the backend */
 	unsigned long		start_time;	/* time at which retrieval started */
+#ifdef CONFIG_FSCACHE_STATS
+	ktime_t			start_ktime;	/* precise start time for cookie stats */
+#endif
 	atomic_t		n_pages;	/* number of pages to be retrieved */
 };
 
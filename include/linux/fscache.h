@@ -166,6 +166,18 @@ struct fscache_netfs {
 	struct list_head		link;		/* internal link */
 };
 
+#ifdef CONFIG_FSCACHE_STATS
+/*
+ * per-cookie I/O latency record
+ * - times are in microseconds
+ */
+struct fscache_cookie_latency {
+	atomic_t			nr;		/* number of events timed */
+	atomic64_t			total_us;	/* sum of latencies */
+	unsigned long			max_us;		/* worst latency seen */
+};
+#endif
+
 /*
  * data file or index object cookie
  * - a file will only appear in one cache
@@ -195,6 +207,11 @@ struct fscache_cookie {
 #define FSCACHE_COOKIE_RELINQUISHED	4	/* T if cookie has been relinquished */
 #define FSCACHE_COOKIE_ENABLED		5	/* T if cookie is enabled */
 #define FSCACHE_COOKIE_ENABLEMENT_LOCK	6	/* T if cookie is being en/disabled */
+
+#ifdef CONFIG_FSCACHE_STATS
+	struct fscache_cookie_latency	retrieval_lat;	/* retrieval op latencies */
+	struct fscache_cookie_latency	store_lat;	/* page store latencies */
+#endif
 };
 
 static inline bool fscache_cookie_enabled(struct fscache_cookie *cookie)
@@ -332,6 +332,9 @@ extern bool fsnotify_notify_queue_is_empty(struct fsnotify_group *group);
 extern struct fsnotify_event *fsnotify_peek_notify_event(struct fsnotify_group *group);
 /* return AND dequeue the first event on the notification queue */
 extern struct fsnotify_event *fsnotify_remove_notify_event(struct fsnotify_group *group);
+/* put a dequeued event back at the head of the notification queue */
+extern void fsnotify_requeue_notify_event(struct fsnotify_group *group,
+					  struct fsnotify_event *event);
 
 /* functions used to manipulate the marks attached to inodes */
 
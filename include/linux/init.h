@@ -188,6 +188,13 @@ extern bool initcall_debug;
  *
  * The `id' arg to __define_initcall() is needed so that multiple initcalls
  * can point at the same handler without causing duplicate-symbol build errors.
+ *
+ * The *_initcall_async() variants run after the plain initcalls of their
+ * level, concurrently with each other, from the async infrastructure.
+ * All of them have finished before the level's *_initcall_sync() calls
+ * start, so those are the place to put anything that depends on them.
+ * Only mark an initcall async if it does not depend on other initcalls
+ * of the same level.
  */
 
 #define __define_initcall(fn, id) \
@@ -218,13 +225,17 @@ extern bool initcall_debug;
 #define arch_initcall(fn)		__define_initcall(fn, 3)
 #define arch_initcall_sync(fn)		__define_initcall(fn, 3s)
 #define subsys_initcall(fn)		__define_initcall(fn, 4)
+#define subsys_initcall_async(fn)	__define_initcall(fn, 4a)
 #define subsys_initcall_sync(fn)	__define_initcall(fn, 4s)
 #define fs_initcall(fn)			__define_initcall(fn, 5)
+#define fs_initcall_async(fn)		__define_initcall(fn, 5a)
 #define fs_initcall_sync(fn)		__define_initcall(fn, 5s)
 #define rootfs_initcall(fn)		__define_initcall(fn, rootfs)
 #define device_initcall(fn)		__define_initcall(fn, 6)
+#define device_initcall_async(fn)	__define_initcall(fn, 6a)
 #define device_initcall_sync(fn)	__define_initcall(fn, 6s)
 #define late_initcall(fn)		__define_initcall(fn, 7)
+#define late_initcall_async(fn)		__define_initcall(fn, 7a)
 #define late_initcall_sync(fn)		__define_initcall(fn, 7s)
 
 #define __initcall(fn) device_initcall(fn)
@@ -303,10 +314,14 @@ void __init parse_early_options(char *cmdline);
 #define postcore_initcall(fn)		module_init(fn)
 #define arch_initcall(fn)		module_init(fn)
 #define subsys_initcall(fn)		module_init(fn)
+#define subsys_initcall_async(fn)	module_init(fn)
 #define fs_initcall(fn)			module_init(fn)
+#define fs_initcall_async(fn)		module_init(fn)
 #define rootfs_initcall(fn)		module_init(fn)
 #define device_initcall(fn)		module_init(fn)
+#define device_initcall_async(fn)	module_init(fn)
 #define late_initcall(fn)		module_init(fn)
+#define late_initcall_async(fn)		module_init(fn)
 
 #define console_initcall(fn)		module_init(fn)
 #define security_initcall(fn)		module_init(fn)
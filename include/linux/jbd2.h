@@ -1079,6 +1079,10 @@ extern void jbd2_journal_destroy_transaction_cache(void);
 extern int  jbd2_journal_init_transaction_cache(void);
 extern void jbd2_journal_free_transaction(transaction_t *);
 
+/* Parallel commit checksum support */
+extern void jbd2_journal_init_csum_wq(void);
+extern void jbd2_journal_destroy_csum_wq(void);
+
 /*
  * Journal locking.
  *
@@ -141,6 +141,8 @@ struct nfs_server {
 	unsigned int		acdirmin;
 	unsigned int		acdirmax;
 	unsigned int		namelen;
+	unsigned int		dio_rpcs;	/* O_DIRECT RPCs in flight per request */
+	unsigned int		dio_commit;	/* O_DIRECT wsize'd chunks per COMMIT */
 	unsigned int		options;	/* extra options enabled by mount */
 #define NFS_OPTION_FSCACHE	0x00000001	/* - local caching enabled */
 #define NFS_OPTION_MIGRATION	0x00000002	/* - NFSv4 migration enabled */
@@ -68,6 +68,10 @@
 #define JFFS2_NODETYPE_XATTR (JFFS2_FEATURE_INCOMPAT | JFFS2_NODE_ACCURATE | 8)
 #define JFFS2_NODETYPE_XREF (JFFS2_FEATURE_INCOMPAT | JFFS2_NODE_ACCURATE | 9)
 
+/* Only meaningful to a kernel which knows to destroy it before writing;
+   any other kernel must mount a file system holding one read-only. */
+#define JFFS2_NODETYPE_CHECKPOINT (JFFS2_FEATURE_ROCOMPAT | JFFS2_NODE_ACCURATE | 10)
+
 /* XATTR Related */
 #define JFFS2_XPREFIX_USER		1	/* for "user." */
 #define JFFS2_XPREFIX_SECURITY		2	/* for "security." */
@@ -78,7 +82,6 @@
 #define JFFS2_ACL_VERSION		0x0001
 
 // Maybe later...
-//#define JFFS2_NODETYPE_CHECKPOINT (JFFS2_FEATURE_RWCOMPAT_DELETE | JFFS2_NODE_ACCURATE | 3)
 //#define JFFS2_NODETYPE_OPTIONS (JFFS2_FEATURE_RWCOMPAT_COPY | JFFS2_NODE_ACCURATE | 4)
 
 
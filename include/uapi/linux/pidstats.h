@@ -0,0 +1,65 @@
+/* pidstats.h - fixed layout per-process statistics records
+ *
+ * Records of this layout are returned by reads of /proc/pidstats and
+ * /proc/pidstats_changed, one per thread group.  The file position is
+ * the pid at which the next read resumes, so a read that returns a
+ * short count can simply be repeated, and lseek(fd, pid, SEEK_SET) can
+ * be used to start anywhere.
+ *
+ * /proc/pidstats_changed only returns thread groups that have run since
+ * the start of the previous complete pass (a pass starts with a read at
+ * position 0 and ends when a read returns 0) made through the same open
+ * file.  The first pass returns everything.
+ */
+
+#ifndef _UAPI_LINUX_PIDSTATS_H
+#define _UAPI_LINUX_PIDSTATS_H
+
+#include <linux/types.h>
+
+#define PIDSTATS_COMM_LEN	16
+
+/* ps_state, the letter shown in /proc/<pid>/stat */
+#define PIDSTATS_STATE_RUNNING		'R'
+#define PIDSTATS_STATE_SLEEPING		'S'
+#define PIDSTATS_STATE_DISK_SLEEP	'D'
+#define PIDSTATS_STATE_STOPPED		'T'
+#define PIDSTATS_STATE_TRACING_STOP	't'
+#define PIDSTATS_STATE_DEAD		'X'
+#define PIDSTATS_STATE_ZOMBIE		'Z'
+
+/* ps_flags */
+#define PIDSTATS_F_IO		0x00000001	/* I/O counters are valid */
+
+struct pidstats {
+	__u32	ps_size;		/* sizeof(struct pidstats) */
+	__s32	ps_pid;			/* thread group id */
+	__s32	ps_ppid;
+	__u32	ps_uid;
+	__u32	ps_gid;
+	__u32	ps_nr_threads;
+	__u32	ps_state;		/* PIDSTATS_STATE_* */
+	__u32	ps_flags;
+	char	ps_comm[PIDSTATS_COMM_LEN];
+
+	__u64	ps_start_time;		/* boot based, in ns */
+	__u64	ps_utime;		/* user time, in ns */
+	__u64	ps_stime;		/* system time, in ns */
+	__u64	ps_min_flt;
+	__u64	ps_maj_flt;
+	__u64	ps_nvcsw;
+	__u64	ps_nivcsw;
+	__u64	ps_vsize;		/* bytes */
+	__u64	ps_rss;			/* pages */
+
+	/* only valid if PIDSTATS_F_IO is set */
+	__u64	ps_rchar;
+	__u64	ps_wchar;
+	__u64	ps_syscr;
+	__u64	ps_syscw;
+	__u64	ps_read_bytes;
+	__u64	ps_write_bytes;
+	__u64	ps_cancelled_write_bytes;
+};
+
+#endif /* _UAPI_LINUX_PIDSTATS_H */
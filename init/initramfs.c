@@ -18,6 +18,9 @@
 #include <linux/dirent.h>
 #include <linux/syscalls.h>
 #include <linux/utime.h>
+#include <linux/initrd.h>
+#include <linux/async.h>
+#include <linux/export.h>
 
 static __initdata char *message;
 static void __init error(char *x)
@@ -580,7 +583,18 @@ static void __init clean_rootfs(void)
 }
 #endif
 
-static int __init populate_rootfs(void)
+static bool initramfs_async;
+static int __init initramfs_async_setup(char *str)
+{
+	strtobool(str, &initramfs_async);
+	return 1;
+}
+__setup("initramfs_async=", initramfs_async_setup);
+
+static ASYNC_DOMAIN_EXCLUSIVE(initramfs_domain);
+static async_cookie_t initramfs_cookie;
+
+static void __init do_populate_rootfs(void *unused, async_cookie_t cookie)
 {
 	char *err = unpack_to_rootfs(__initramfs_start, __initramfs_size);
 	if (err)
@@ -619,10 +633,42 @@ static int __init populate_rootfs(void)
 #endif
 		/*
 		 * Try loading default modules from initramfs.  This gives
-		 * us a chance to load before device_initcalls.
+		 * us a chance to load before device_initcalls.  When we are
+		 * unpacking asynchronously the usermode helper would wait
+		 * for us, so leave it to kernel_init_freeable().
 		 */
-		load_default_modules();
+		if (!initramfs_async)
+			load_default_modules();
 	}
+}
+
+/*
+ * Anything that may look up files in rootfs (opening the console, usermode
+ * helpers, firmware loading) must call this before doing so.  Calls made
+ * before populate_rootfs() has run see an empty rootfs either way.
+ */
+void wait_for_initramfs(void)
+{
+	if (!initramfs_cookie)
+		return;
+	async_synchronize_full_domain(&initramfs_domain);
+}
+EXPORT_SYMBOL_GPL(wait_for_initramfs);
+
+/*
+ * Decompressing a large initramfs can take a good part of the boot time.
+ * "initramfs_async=1" lets it overlap with the device initcalls that
+ * follow; code that reads rootfs before the unpacking is done has to call
+ * wait_for_initramfs(), so it stays opt-in until all such users do.
+ */
+static int __init populate_rootfs(void)
+{
+	if (initramfs_async)
+		initramfs_cookie = async_schedule_domain(do_populate_rootfs,
+							 NULL,
+							 &initramfs_domain);
+	else
+		do_populate_rootfs(NULL, 0);
 	return 0;
 }
 rootfs_initcall(populate_rootfs);
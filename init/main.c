@@ -666,6 +666,41 @@ static void __init do_ctors(void)
 bool initcall_debug;
 core_param(initcall_debug, initcall_debug, bool, 0644);
 
+/*
+ * With initcall_debug, remember the slowest initcalls seen during boot so
+ * that the critical path can be reported once all levels have run.
+ */
+#define INITCALL_SLOWEST	10
+
+struct initcall_timing {
+	initcall_t fn;
+	unsigned long long usecs;
+};
+
+static struct initcall_timing initcall_slowest[INITCALL_SLOWEST];
+static DEFINE_SPINLOCK(initcall_timing_lock);
+
+static void initcall_record(initcall_t fn, unsigned long long usecs)
+{
+	int i;
+
+	if (system_state != SYSTEM_BOOTING)
+		return;
+
+	spin_lock(&initcall_timing_lock);
+	for (i = 0; i < INITCALL_SLOWEST; i++) {
+		if (usecs > initcall_slowest[i].usecs)
+			break;
+	}
+	if (i < INITCALL_SLOWEST) {
+		memmove(&initcall_slowest[i + 1], &initcall_slowest[i],
+			(INITCALL_SLOWEST - i - 1) * sizeof(initcall_slowest[0]));
+		initcall_slowest[i].fn = fn;
+		initcall_slowest[i].usecs = usecs;
+	}
+	spin_unlock(&initcall_timing_lock);
+}
+
 static int __init_or_module do_one_initcall_debug(initcall_t fn)
 {
 	ktime_t calltime, delta, rettime;
@@ -680,6 +715,7 @@ static int __init_or_module do_one_initcall_debug(initcall_t fn)
 	duration = (unsigned long long) ktime_to_ns(delta) >> 10;
 	pr_debug("initcall %pF returned %d after %lld usecs\n",
 		 fn, ret, duration);
+	initcall_record(fn, duration);
 
 	return ret;
 }
@@ -722,6 +758,15 @@ extern initcall_t __initcall6_start[];
 extern initcall_t __initcall7_start[];
 extern initcall_t __initcall_end[];
 
+extern initcall_t __initcall0a_start[], __initcall0a_end[];
+extern initcall_t __initcall1a_start[], __initcall1a_end[];
+extern initcall_t __initcall2a_start[], __initcall2a_end[];
+extern initcall_t __initcall3a_start[], __initcall3a_end[];
+extern initcall_t __initcall4a_start[], __initcall4a_end[];
+extern initcall_t __initcall5a_start[], __initcall5a_end[];
+extern initcall_t __initcall6a_start[], __initcall6a_end[];
+extern initcall_t __initcall7a_start[], __initcall7a_end[];
+
 static initcall_t *initcall_levels[] __initdata = {
 	__initcall0_start,
 	__initcall1_start,
@@ -734,6 +779,27 @@ static initcall_t *initcall_levels[] __initdata = {
 	__initcall_end,
 };
 
+/* The *_initcall_async() sections, bracketed per level */
+static initcall_t *initcall_async_levels[][2] __initdata = {
+	{ __initcall0a_start, __initcall0a_end },
+	{ __initcall1a_start, __initcall1a_end },
+	{ __initcall2a_start, __initcall2a_end },
+	{ __initcall3a_start, __initcall3a_end },
+	{ __initcall4a_start, __initcall4a_end },
+	{ __initcall5a_start, __initcall5a_end },
+	{ __initcall6a_start, __initcall6a_end },
+	{ __initcall7a_start, __initcall7a_end },
+};
+
+static unsigned long long initcall_level_usecs[8] __initdata;
+
+static ASYNC_DOMAIN(initcall_domain);
+
+static void __init do_one_initcall_async(void *data, async_cookie_t cookie)
+{
+	do_one_initcall(*(initcall_t *)data);
+}
+
 /* Keep these in sync with initcalls in include/linux/init.h */
 static char *initcall_level_names[] __initdata = {
 	"early",
@@ -749,6 +815,9 @@ static char *initcall_level_names[] __initdata = {
 static void __init do_initcall_level(int level)
 {
 	extern const struct kernel_param __start___param[], __stop___param[];
+	initcall_t *async_start = initcall_async_levels[level][0];
+	initcall_t *async_end = initcall_async_levels[level][1];
+	ktime_t calltime = ktime_get();
 	initcall_t *fn;
 
 	strcpy(initcall_command_line, saved_command_line);
@@ -758,8 +827,35 @@ static void __init do_initcall_level(int level)
 		   level, level,
 		   &repair_env_string);
 
-	for (fn = initcall_levels[level]; fn < initcall_levels[level+1]; fn++)
-		do_one_initcall(*fn);
+	for (fn = initcall_levels[level]; fn < initcall_levels[level+1]; fn++) {
+		/* The async section ends where the _sync initcalls begin */
+		if (fn == async_end && async_start != async_end)
+			async_synchronize_full_domain(&initcall_domain);
+		if (fn >= async_start && fn < async_end)
+			async_schedule_domain(do_one_initcall_async, fn,
+					      &initcall_domain);
+		else
+			do_one_initcall(*fn);
+	}
+	async_synchronize_full_domain(&initcall_domain);
+
+	initcall_level_usecs[level] =
+		ktime_to_ns(ktime_sub(ktime_get(), calltime)) >> 10;
+}
+
+static void __init initcall_report_critical_path(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(initcall_levels) - 1; i++)
+		pr_info("initcall critical path: level %-8s %llu usecs (%ld async)\n",
+			initcall_level_names[i], initcall_level_usecs[i],
+			(long)(initcall_async_levels[i][1] -
+			       initcall_async_levels[i][0]));
+
+	for (i = 0; i < INITCALL_SLOWEST && initcall_slowest[i].fn; i++)
+		pr_info("initcall critical path: %pF %llu usecs\n",
+			initcall_slowest[i].fn, initcall_slowest[i].usecs);
 }
 
 static void __init do_initcalls(void)
@@ -768,6 +864,9 @@ static void __init do_initcalls(void)
 
 	for (level = 0; level < ARRAY_SIZE(initcall_levels) - 1; level++)
 		do_initcall_level(level);
+
+	if (initcall_debug)
+		initcall_report_critical_path();
 }
 
 /*
@@ -909,6 +1008,9 @@ static noinline void __init kernel_init_freeable(void)
 
 	do_basic_setup();
 
+	/* Everything below looks at rootfs */
+	wait_for_initramfs();
+
 	/* Open the /dev/console on the rootfs, this should never fail */
 	if (sys_open((const char __user *) "/dev/console", O_RDWR, 0) < 0)
 		pr_err("Warning: unable to open an initial console.\n");
@@ -39,6 +39,7 @@
 #include <linux/rwsem.h>
 #include <linux/ptrace.h>
 #include <linux/async.h>
+#include <linux/initrd.h>
 #include <asm/uaccess.h>
 
 #include <trace/events/module.h>
@@ -239,6 +240,13 @@ static int ____call_usermodehelper(void *data)
 
 	commit_creds(new);
 
+	/*
+	 * The helper binary may live in an initramfs still being unpacked.
+	 * Wait here rather than in call_usermodehelper_exec(), which can be
+	 * called from atomic context with UMH_NO_WAIT.
+	 */
+	wait_for_initramfs();
+
 	retval = do_execve(getname_kernel(sub_info->path),
 			   (const char __user *const __user *)sub_info->argv,
 			   (const char __user *const __user *)sub_info->envp);
@@ -102,6 +102,10 @@ extern int suid_dumpable;
 extern int core_uses_pid;
 extern char core_pattern[];
 extern unsigned int core_pipe_limit;
+#ifdef CONFIG_COREDUMP_COMPRESS
+extern int core_compress;
+static int nine = 9;
+#endif
 #endif
 extern int pid_max;
 extern int pid_max_min, pid_max_max;
@@ -133,6 +137,9 @@ static int ten_thousand = 10000;
 /* this is needed for the proc_doulongvec_minmax of vm_dirty_bytes */
 static unsigned long dirty_bytes_min = 2 * PAGE_SIZE;
 
+/* this is needed for the proc_dointvec_minmax of vm_dirty_writeback_workers */
+static int wb_max_workers = WB_MAX_WORKERS;
+
 /* this is needed for the proc_dointvec_minmax for [fs_]overflow UID and GID */
 static int maxolduid = 65535;
 static int minolduid;
@@ -486,6 +493,17 @@ static struct ctl_table kern_table[] = {
 		.mode		= 0644,
 		.proc_handler	= proc_dointvec,
 	},
+#ifdef CONFIG_COREDUMP_COMPRESS
+	{
+		.procname	= "core_compress",
+		.data		= &core_compress,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &zero,
+		.extra2		= &nine,
+	},
+#endif
 #endif
 #ifdef CONFIG_PROC_SYSCTL
 	{
@@ -1196,6 +1214,15 @@ static struct ctl_table vm_table[] = {
 		.proc_handler	= proc_dointvec_minmax,
 		.extra1		= &zero,
 	},
+	{
+		.procname	= "dirty_writeback_workers",
+		.data		= &dirty_writeback_workers,
+		.maxlen		= sizeof(dirty_writeback_workers),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &one,
+		.extra2		= &wb_max_workers,
+	},
 	{
 		.procname       = "nr_pdflush_threads",
 		.mode           = 0444 /* read-only */,
@@ -214,6 +214,9 @@ static void __blk_add_trace(struct blk_trace *bt, sector_t sector, int bytes,
 	if (unlikely(bt->trace_state != Blktrace_running && !blk_tracer))
 		return;
 
+	if (unlikely(bt->aggregate) && !blk_tracer)
+		return;
+
 	what |= ddir_act[rw & WRITE];
 	what |= MASK_TC_BIT(rw, SYNC);
 	what |= MASK_TC_BIT(rw, RAHEAD);
@@ -286,17 +289,204 @@ record_it:
 	local_irq_restore(flags);
 }
 
+/*
+ * Latency aggregation. When "aggregate" is set for a trace, no per-event
+ * records are written to the relay channel. Instead the queue->dispatch,
+ * dispatch->complete and queue->complete times of each request are
+ * counted in per-cpu log2 histograms, which are read out (and reset) via
+ * the "latency" debugfs file.
+ */
+enum {
+	BLK_LAT_READ,
+	BLK_LAT_WRITE,
+	BLK_LAT_OTHER,		/* discard and flush */
+	BLK_LAT_NR_OPS,
+};
+
+enum {
+	BLK_LAT_Q2D,
+	BLK_LAT_D2C,
+	BLK_LAT_Q2C,
+	BLK_LAT_NR_STAGES,
+};
+
+/* Bucket 0 counts < 1 usec, bucket n counts [2^(n-1), 2^n) usecs */
+#define BLK_LAT_NR_BUCKETS	32
+
+struct blk_trace_lat {
+	u64 hist[BLK_LAT_NR_OPS][BLK_LAT_NR_STAGES][BLK_LAT_NR_BUCKETS];
+};
+
+static const char * const blk_lat_op_names[BLK_LAT_NR_OPS] = {
+	"read", "write", "other",
+};
+
+static const char * const blk_lat_stage_names[BLK_LAT_NR_STAGES] = {
+	"q2d", "d2c", "q2c",
+};
+
+static void blk_lat_account(struct blk_trace *bt, int op, int stage,
+			    u64 start, u64 end)
+{
+	unsigned int idx, bucket;
+
+	if (!start || end < start)
+		return;
+
+	bucket = min_t(unsigned int,
+		       fls64(div_u64(end - start, NSEC_PER_USEC)),
+		       BLK_LAT_NR_BUCKETS - 1);
+
+	/*
+	 * Probes run with preemption disabled, which is what the snapshot
+	 * side waits for with synchronize_sched() after switching lat_idx.
+	 */
+	idx = ACCESS_ONCE(bt->lat_idx);
+	this_cpu_inc(bt->lat[idx]->hist[op][stage][bucket]);
+}
+
+static void blk_add_trace_rq_lat(struct blk_trace *bt, struct request *rq,
+				 u32 what)
+{
+	u64 now;
+	int op;
+
+	if (bt->trace_state != Blktrace_running ||
+	    rq->cmd_type != REQ_TYPE_FS)
+		return;
+
+	if (rq->cmd_flags & (REQ_DISCARD | REQ_FLUSH))
+		op = BLK_LAT_OTHER;
+	else if (rq_data_dir(rq) == WRITE)
+		op = BLK_LAT_WRITE;
+	else
+		op = BLK_LAT_READ;
+
+	/*
+	 * Use the request's own start_time_ns (set at allocation) and
+	 * io_start_time_ns (set when it is handed to the driver) rather than
+	 * stamping it ourselves, so "q" here starts at allocation, and
+	 * compare them against the same clock.
+	 */
+	now = local_clock();
+
+	switch (what) {
+	case BLK_TA_ISSUE:
+		blk_lat_account(bt, op, BLK_LAT_Q2D, rq_start_time_ns(rq), now);
+		break;
+	case BLK_TA_COMPLETE:
+		blk_lat_account(bt, op, BLK_LAT_D2C, rq_io_start_time_ns(rq),
+				now);
+		blk_lat_account(bt, op, BLK_LAT_Q2C, rq_start_time_ns(rq), now);
+		break;
+	}
+}
+
+#define BLK_LAT_SNAPSHOT_SIZE	8192
+
+struct blk_lat_snapshot {
+	size_t len;
+	char buf[BLK_LAT_SNAPSHOT_SIZE];
+};
+
+/*
+ * Opening "latency" atomically takes the histograms accumulated since the
+ * previous open and resets them; reads then return that snapshot.
+ */
+static int blk_latency_open(struct inode *inode, struct file *filp)
+{
+	struct blk_trace *bt = inode->i_private;
+	struct blk_lat_snapshot *snap;
+	struct blk_trace_lat *sum;
+	unsigned int idx;
+	int cpu, op, stage, i;
+
+	snap = kmalloc(sizeof(*snap), GFP_KERNEL);
+	sum = kzalloc(sizeof(*sum), GFP_KERNEL);
+	if (!snap || !sum) {
+		kfree(snap);
+		kfree(sum);
+		return -ENOMEM;
+	}
+
+	mutex_lock(&bt->lat_mutex);
+	idx = bt->lat_idx;
+	ACCESS_ONCE(bt->lat_idx) = !idx;
+	synchronize_sched();
+
+	for_each_possible_cpu(cpu) {
+		struct blk_trace_lat *lat = per_cpu_ptr(bt->lat[idx], cpu);
+
+		for (op = 0; op < BLK_LAT_NR_OPS; op++)
+			for (stage = 0; stage < BLK_LAT_NR_STAGES; stage++)
+				for (i = 0; i < BLK_LAT_NR_BUCKETS; i++)
+					sum->hist[op][stage][i] +=
+						lat->hist[op][stage][i];
+		memset(lat, 0, sizeof(*lat));
+	}
+	mutex_unlock(&bt->lat_mutex);
+
+	snap->len = scnprintf(snap->buf, BLK_LAT_SNAPSHOT_SIZE,
+			      "# bucket 0: <1us, bucket n: [2^(n-1), 2^n) us\n");
+	for (op = 0; op < BLK_LAT_NR_OPS; op++) {
+		for (stage = 0; stage < BLK_LAT_NR_STAGES; stage++) {
+			snap->len += scnprintf(snap->buf + snap->len,
+					BLK_LAT_SNAPSHOT_SIZE - snap->len,
+					"%s %s", blk_lat_op_names[op],
+					blk_lat_stage_names[stage]);
+			for (i = 0; i < BLK_LAT_NR_BUCKETS; i++)
+				snap->len += scnprintf(snap->buf + snap->len,
+					BLK_LAT_SNAPSHOT_SIZE - snap->len,
+					" %llu", sum->hist[op][stage][i]);
+			snap->len += scnprintf(snap->buf + snap->len,
+					BLK_LAT_SNAPSHOT_SIZE - snap->len,
+					"\n");
+		}
+	}
+
+	kfree(sum);
+	filp->private_data = snap;
+	return 0;
+}
+
+static ssize_t blk_latency_read(struct file *filp, char __user *buffer,
+				size_t count, loff_t *ppos)
+{
+	struct blk_lat_snapshot *snap = filp->private_data;
+
+	return simple_read_from_buffer(buffer, count, ppos, snap->buf,
+				       snap->len);
+}
+
+static int blk_latency_release(struct inode *inode, struct file *filp)
+{
+	kfree(filp->private_data);
+	return 0;
+}
+
+static const struct file_operations blk_latency_fops = {
+	.owner =	THIS_MODULE,
+	.open =		blk_latency_open,
+	.read =		blk_latency_read,
+	.release =	blk_latency_release,
+	.llseek =	default_llseek,
+};
+
 static struct dentry *blk_tree_root;
 static DEFINE_MUTEX(blk_tree_mutex);
 
 static void blk_trace_free(struct blk_trace *bt)
 {
+	debugfs_remove(bt->latency_file);
+	debugfs_remove(bt->aggregate_file);
 	debugfs_remove(bt->msg_file);
 	debugfs_remove(bt->dropped_file);
 	relay_close(bt->rchan);
 	debugfs_remove(bt->dir);
 	free_percpu(bt->sequence);
 	free_percpu(bt->msg_data);
+	free_percpu(bt->lat[0]);
+	free_percpu(bt->lat[1]);
 	kfree(bt);
 }
 
@@ -468,6 +658,12 @@ int do_blk_trace_setup(struct request_queue *q, char *name, dev_t dev,
 	if (!bt->msg_data)
 		goto err;
 
+	bt->lat[0] = alloc_percpu(struct blk_trace_lat);
+	bt->lat[1] = alloc_percpu(struct blk_trace_lat);
+	if (!bt->lat[0] || !bt->lat[1])
+		goto err;
+	mutex_init(&bt->lat_mutex);
+
 	ret = -ENOENT;
 
 	mutex_lock(&blk_tree_mutex);
@@ -500,6 +696,16 @@ int do_blk_trace_setup(struct request_queue *q, char *name, dev_t dev,
 	if (!bt->msg_file)
 		goto err;
 
+	bt->aggregate_file = debugfs_create_bool("aggregate", 0644, dir,
+						 &bt->aggregate);
+	if (!bt->aggregate_file)
+		goto err;
+
+	bt->latency_file = debugfs_create_file("latency", 0400, dir, bt,
+					       &blk_latency_fops);
+	if (!bt->latency_file)
+		goto err;
+
 	bt->rchan = relay_open("trace", dir, buts->buf_size,
 				buts->buf_nr, &blk_relay_callbacks, bt);
 	if (!bt->rchan)
@@ -717,6 +923,11 @@ static void blk_add_trace_rq(struct request_queue *q, struct request *rq,
 	if (likely(!bt))
 		return;
 
+	if (unlikely(bt->aggregate)) {
+		blk_add_trace_rq_lat(bt, rq, what);
+		return;
+	}
+
 	if (rq->cmd_type == REQ_TYPE_BLOCK_PC) {
 		what |= BLK_TC_ACT(BLK_TC_PC);
 		__blk_add_trace(bt, 0, nr_bytes, rq->cmd_flags,
@@ -217,7 +217,8 @@ static void raid6_exit(void)
 	do { } while (0);
 }
 
-subsys_initcall(raid6_select_algo);
+/* Benchmarking takes a while, and nothing else in this level needs it */
+subsys_initcall_async(raid6_select_algo);
 module_exit(raid6_exit);
 MODULE_LICENSE("GPL");
 MODULE_DESCRIPTION("RAID6 Q-syndrome calculations");
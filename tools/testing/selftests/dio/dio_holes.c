@@ -0,0 +1,122 @@
+/*
+ * O_DIRECT reads and writes over holes and allocated blocks of a sparse
+ * file.  Small synchronous requests take the direct-io fast path only when
+ * the blocks are already mapped; everything else has to fall back to the
+ * general path without leaving stale or unwritten data behind.
+ *
+ * The file is created in the current directory, or in the directory given
+ * as the first argument, since tmpfs does not support O_DIRECT.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define BLK		4096
+#define FILE_SIZE	(1024 * 1024)
+
+static char path[PATH_MAX];
+static char *buf, *pat;
+static int fd;
+
+static int check(const char *what, off_t off, size_t len, const char *expect)
+{
+	ssize_t ret;
+
+	memset(buf, 0xaa, len);
+	ret = pread(fd, buf, len, off);
+	if (ret != (ssize_t)len) {
+		fprintf(stderr, "%s: pread at %lld returned %zd: %s\n",
+			what, (long long)off, ret, strerror(errno));
+		return 1;
+	}
+	if (memcmp(buf, expect, len)) {
+		fprintf(stderr, "%s: data mismatch at %lld\n",
+			what, (long long)off);
+		return 1;
+	}
+	return 0;
+}
+
+static int write_pat(const char *what, off_t off, size_t len, int c)
+{
+	ssize_t ret;
+
+	memset(pat, c, len);
+	ret = pwrite(fd, pat, len, off);
+	if (ret != (ssize_t)len) {
+		fprintf(stderr, "%s: pwrite at %lld returned %zd: %s\n",
+			what, (long long)off, ret, strerror(errno));
+		return 1;
+	}
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	const char *dir = argc > 1 ? argv[1] : ".";
+	char *zero;
+	int err = 0;
+
+	snprintf(path, sizeof(path), "%s/dio_holes.%d", dir, getpid());
+	fd = open(path, O_RDWR | O_CREAT | O_EXCL | O_DIRECT, 0600);
+	if (fd < 0) {
+		if (errno == EINVAL) {
+			printf("dio_holes: O_DIRECT not supported in %s [SKIP]\n",
+			       dir);
+			return 0;
+		}
+		perror("open");
+		return 1;
+	}
+	unlink(path);
+
+	if (posix_memalign((void **)&buf, BLK, 4 * BLK) ||
+	    posix_memalign((void **)&pat, BLK, 4 * BLK)) {
+		perror("posix_memalign");
+		return 1;
+	}
+	zero = calloc(1, 4 * BLK);
+	if (!zero || ftruncate(fd, FILE_SIZE)) {
+		perror("ftruncate");
+		return 1;
+	}
+
+	/* reads over a hole see zeroes */
+	err |= check("read hole", 16 * BLK, BLK, zero);
+	err |= check("read hole x4", 20 * BLK, 4 * BLK, zero);
+
+	/* a write into a hole allocates and reads back */
+	err |= write_pat("write hole", 32 * BLK, BLK, 0x11);
+	err |= check("read filled hole", 32 * BLK, BLK, pat);
+
+	/* an overwrite of the now allocated block */
+	err |= write_pat("overwrite", 32 * BLK, BLK, 0x22);
+	err |= check("read overwrite", 32 * BLK, BLK, pat);
+
+	/* a write covering an allocated block followed by a hole */
+	err |= write_pat("write data+hole", 32 * BLK, 4 * BLK, 0x33);
+	err |= check("read data+hole", 32 * BLK, 4 * BLK, pat);
+
+	/* the blocks around the written range are still holes */
+	err |= check("read before", 31 * BLK, BLK, zero);
+	err |= check("read after", 36 * BLK, BLK, zero);
+
+	/* a read straddling data and a hole */
+	memset(pat, 0x33, BLK);
+	memset(pat + BLK, 0, BLK);
+	err |= check("read data+hole", 35 * BLK, 2 * BLK, pat);
+
+	close(fd);
+
+	if (err) {
+		printf("dio_holes: [FAIL]\n");
+		return 1;
+	}
+	printf("dio_holes: [PASS]\n");
+	return 0;
+}
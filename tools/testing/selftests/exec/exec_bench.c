@@ -0,0 +1,139 @@
+/*
+ * Measure fork + exec + exit latency of a small dynamically linked binary
+ * (this one), with the binfmt_elf layout cache off and on.  The cache is
+ * switched through /sys/module/binfmt_elf/parameters/elf_layout_cache and
+ * restored afterwards; without root or without the parameter only the
+ * current setting is measured.
+ *
+ * Usage: exec_bench [iterations]
+ */
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define PARAM	"/sys/module/binfmt_elf/parameters/elf_layout_cache"
+#define WARMUP	100
+
+static char self[4096];
+
+static int get_param(void)
+{
+	char buf[8];
+	ssize_t ret;
+	int fd;
+
+	fd = open(PARAM, O_RDONLY);
+	if (fd < 0)
+		return -1;
+	ret = read(fd, buf, sizeof(buf));
+	close(fd);
+	if (ret <= 0)
+		return -1;
+	return buf[0] == 'Y' || buf[0] == '1';
+}
+
+static int set_param(int on)
+{
+	int fd, ret;
+
+	fd = open(PARAM, O_WRONLY);
+	if (fd < 0)
+		return -1;
+	ret = write(fd, on ? "1" : "0", 1);
+	close(fd);
+	return ret == 1 ? 0 : -1;
+}
+
+static int spawn(void)
+{
+	char *argv[] = { self, "--child", NULL };
+	int status;
+	pid_t pid;
+
+	pid = fork();
+	if (pid < 0) {
+		perror("fork");
+		return -1;
+	}
+	if (!pid) {
+		execv(self, argv);
+		_exit(127);
+	}
+	if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) ||
+	    WEXITSTATUS(status)) {
+		fprintf(stderr, "exec of %s failed\n", self);
+		return -1;
+	}
+	return 0;
+}
+
+/* Returns the mean latency of one fork + exec + exit in nanoseconds. */
+static double measure(int iterations)
+{
+	struct timespec start, end;
+	int i;
+
+	for (i = 0; i < WARMUP; i++)
+		if (spawn())
+			return -1;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < iterations; i++)
+		if (spawn())
+			return -1;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	return ((end.tv_sec - start.tv_sec) * 1e9 +
+		(end.tv_nsec - start.tv_nsec)) / iterations;
+}
+
+int main(int argc, char **argv)
+{
+	int iterations = 2000;
+	double off, on;
+	ssize_t len;
+	int orig;
+
+	if (argc > 1 && !strcmp(argv[1], "--child"))
+		return 0;
+	if (argc > 1)
+		iterations = atoi(argv[1]);
+	if (iterations <= 0) {
+		fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+		return 1;
+	}
+
+	len = readlink("/proc/self/exe", self, sizeof(self) - 1);
+	if (len < 0) {
+		perror("readlink");
+		return 1;
+	}
+	self[len] = '\0';
+
+	orig = get_param();
+	if (orig < 0 || set_param(orig)) {
+		printf("exec_bench: cannot switch %s, measuring as is\n", PARAM);
+		on = measure(iterations);
+		if (on < 0)
+			return 1;
+		printf("exec_bench: %.1f usec per exec\n", on / 1000);
+		return 0;
+	}
+
+	set_param(0);
+	off = measure(iterations);
+	set_param(1);
+	on = measure(iterations);
+	set_param(orig);
+	if (off < 0 || on < 0)
+		return 1;
+
+	printf("exec_bench: %d execs, cache off %.1f usec, on %.1f usec (%+.1f%%)\n",
+	       iterations, off / 1000, on / 1000, (on - off) * 100 / off);
+	return 0;
+}
@@ -0,0 +1,76 @@
+#!/bin/bash
+#
+# Measure parallel write throughput on an f2fs image backed by brd, with
+# the background GC free section reserve disabled and at its default, and
+# report how often writers fell into foreground GC.
+#
+# Needs root, the brd module and mkfs.f2fs.  Usage:
+#	gc_reserve_bench.sh [disk size in MB] [writers] [MB per writer]
+
+SIZE_MB=${1:-1024}
+WRITERS=${2:-8}
+PER_WRITER_MB=${3:-96}
+MNT=$(mktemp -d /tmp/f2fs_bench.XXXXXX)
+DEV=/dev/ram0
+
+skip()
+{
+	echo "f2fs gc_reserve_bench: $1, skipping"
+	rmdir "$MNT"
+	exit 0
+}
+
+[ "$(id -u)" -eq 0 ] || skip "not root"
+which mkfs.f2fs >/dev/null 2>&1 || skip "no mkfs.f2fs"
+[ -e $DEV ] && skip "$DEV already exists"
+modprobe brd rd_nr=1 rd_size=$((SIZE_MB * 1024)) || skip "no brd"
+
+cleanup()
+{
+	umount "$MNT" 2>/dev/null
+	rmdir "$MNT"
+	rmmod brd
+}
+trap cleanup EXIT
+
+run()
+{
+	local reserve=$1
+	local sysfs start end gc_before gc_after i
+
+	mkfs.f2fs -q $DEV >/dev/null || return 1
+	mount -t f2fs $DEV "$MNT" || return 1
+	sysfs=/sys/fs/f2fs/$(basename $DEV)
+	echo $reserve > $sysfs/gc_reserve_sections
+
+	# Age the image: fill it, then punch holes so that GC has work to do
+	for i in $(seq $WRITERS); do
+		dd if=/dev/zero of="$MNT/fill$i" bs=1M \
+		   count=$((PER_WRITER_MB / 2)) conv=fsync 2>/dev/null &
+	done
+	wait
+	for i in $(seq 2 2 $WRITERS); do
+		rm -f "$MNT/fill$i"
+	done
+	sync
+
+	gc_before=$(awk '/GC calls/ { print $NF; exit }' \
+		    /sys/kernel/debug/f2fs/status 2>/dev/null)
+	start=$(date +%s%N)
+	for i in $(seq $WRITERS); do
+		dd if=/dev/zero of="$MNT/w$i" bs=64k \
+		   count=$((PER_WRITER_MB * 16)) conv=fsync 2>/dev/null &
+	done
+	wait
+	end=$(date +%s%N)
+	gc_after=$(awk '/GC calls/ { print $NF; exit }' \
+		   /sys/kernel/debug/f2fs/status 2>/dev/null)
+
+	echo "gc_reserve_sections=$reserve:" \
+	     "$((WRITERS * PER_WRITER_MB * 1000000000 / (end - start))) MB/s," \
+	     "GC calls ${gc_before:-?} -> ${gc_after:-?}"
+	umount "$MNT"
+}
+
+run 0 || exit 1
+run 4 || exit 1
@@ -0,0 +1,114 @@
+/*
+ * Check that repeated IN_MODIFY events for files in a watched directory
+ * are merged, even when writes to different files interleave.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+#define NR_WRITES	100
+
+static char dir[] = "/tmp/inotify_merge.XXXXXX";
+static char path_a[PATH_MAX], path_b[PATH_MAX];
+
+static void cleanup(void)
+{
+	unlink(path_a);
+	unlink(path_b);
+	rmdir(dir);
+}
+
+static int count_events(int ifd, int *nr_a, int *nr_b)
+{
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	struct inotify_event *ev;
+	ssize_t len;
+	char *p;
+
+	*nr_a = *nr_b = 0;
+	for (;;) {
+		len = read(ifd, buf, sizeof(buf));
+		if (len < 0) {
+			if (errno == EAGAIN)
+				return 0;
+			perror("read");
+			return -1;
+		}
+		for (p = buf; p < buf + len; p += sizeof(*ev) + ev->len) {
+			ev = (struct inotify_event *)p;
+			if (!(ev->mask & IN_MODIFY) || !ev->len)
+				continue;
+			if (!strcmp(ev->name, "a"))
+				(*nr_a)++;
+			else if (!strcmp(ev->name, "b"))
+				(*nr_b)++;
+		}
+	}
+}
+
+int main(void)
+{
+	int ifd, fa, fb, i, nr_a, nr_b;
+
+	if (!mkdtemp(dir)) {
+		perror("mkdtemp");
+		return 1;
+	}
+	snprintf(path_a, sizeof(path_a), "%s/a", dir);
+	snprintf(path_b, sizeof(path_b), "%s/b", dir);
+	atexit(cleanup);
+
+	fa = open(path_a, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	fb = open(path_b, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	if (fa < 0 || fb < 0) {
+		perror("open");
+		return 1;
+	}
+
+	ifd = inotify_init1(IN_NONBLOCK);
+	if (ifd < 0) {
+		perror("inotify_init1");
+		return 1;
+	}
+	if (inotify_add_watch(ifd, dir, IN_MODIFY) < 0) {
+		perror("inotify_add_watch");
+		return 1;
+	}
+
+	/* Consecutive writes to one file */
+	for (i = 0; i < NR_WRITES; i++)
+		if (write(fa, "x", 1) != 1) {
+			perror("write");
+			return 1;
+		}
+	if (count_events(ifd, &nr_a, &nr_b))
+		return 1;
+	if (nr_a != 1) {
+		printf("inotify_merge: %d writes to one file gave %d events: [FAIL]\n",
+		       NR_WRITES, nr_a);
+		return 1;
+	}
+
+	/* Interleaved writes to two files need the deep merge */
+	for (i = 0; i < NR_WRITES; i++)
+		if (write(i & 1 ? fb : fa, "x", 1) != 1) {
+			perror("write");
+			return 1;
+		}
+	if (count_events(ifd, &nr_a, &nr_b))
+		return 1;
+	if (nr_a != 1 || nr_b != 1) {
+		printf("inotify_merge: interleaved writes gave %d + %d events: [FAIL]\n",
+		       nr_a, nr_b);
+		return 1;
+	}
+
+	printf("inotify_merge: [PASS]\n");
+	return 0;
+}
@@ -0,0 +1,213 @@
+/*
+ * Read sysfs attributes from several threads while network devices are
+ * created, renamed and removed underneath them.  This exercises kernfs
+ * path walk in RCU mode against kernfs_rename(), where revalidate has to
+ * notice the rename through kernfs_rename_seq, and against removal, where
+ * nodes and their names are freed from an RCU callback.
+ *
+ * After every rename the attributes must be reachable under the new name
+ * and report the same ifindex.  Needs root and the dummy module.
+ */
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <net/if.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#define NR_READERS	8
+#define NR_DEVS		4
+#define NR_ROUNDS	200
+
+static volatile int stop;
+static volatile int failed;
+static unsigned long nr_reads[NR_READERS];
+
+static const char *names[] = {
+	"kfst0", "kfst1", "kfst2", "kfst3",
+	"kfsr0", "kfsr1", "kfsr2", "kfsr3",
+};
+
+#define NR_NAMES	(sizeof(names) / sizeof(names[0]))
+
+/* Returns 1 if the attribute was read, 0 if it went away. */
+static int read_attr(const char *dev, const char *attr, char *buf, size_t len)
+{
+	char path[128];
+	ssize_t ret;
+	int fd;
+
+	snprintf(path, sizeof(path), "/sys/class/net/%s/%s", dev, attr);
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		if (errno != ENOENT && errno != ENODEV) {
+			fprintf(stderr, "open %s: %s\n", path, strerror(errno));
+			failed = 1;
+		}
+		return 0;
+	}
+	ret = read(fd, buf, len - 1);
+	close(fd);
+	if (ret < 0) {
+		if (errno != ENODEV) {
+			fprintf(stderr, "read %s: %s\n", path, strerror(errno));
+			failed = 1;
+		}
+		return 0;
+	}
+	buf[ret] = '\0';
+	return 1;
+}
+
+static void *reader(void *arg)
+{
+	unsigned long *count = arg;
+	char path[128], buf[64];
+	struct dirent *de;
+	struct stat st;
+	unsigned int i;
+	DIR *d;
+
+	while (!stop) {
+		for (i = 0; i < NR_NAMES; i++) {
+			*count += read_attr(names[i], "ifindex", buf, sizeof(buf));
+			*count += read_attr(names[i], "mtu", buf, sizeof(buf));
+			snprintf(path, sizeof(path),
+				 "/sys/devices/virtual/net/%s/statistics/rx_bytes",
+				 names[i]);
+			stat(path, &st);
+		}
+
+		d = opendir("/sys/devices/virtual/net");
+		if (!d)
+			continue;
+		while ((de = readdir(d)) != NULL) {
+			if (strncmp(de->d_name, "kfs", 3))
+				continue;
+			*count += read_attr(de->d_name, "operstate", buf,
+					    sizeof(buf));
+		}
+		closedir(d);
+	}
+	return NULL;
+}
+
+static int run(const char *fmt, ...)
+{
+	char cmd[128];
+	va_list ap;
+
+	va_start(ap, fmt);
+	vsnprintf(cmd, sizeof(cmd), fmt, ap);
+	va_end(ap);
+	return system(cmd);
+}
+
+static int rename_dev(int sock, const char *from, const char *to)
+{
+	struct ifreq ifr;
+
+	memset(&ifr, 0, sizeof(ifr));
+	strncpy(ifr.ifr_name, from, IFNAMSIZ - 1);
+	strncpy(ifr.ifr_newname, to, IFNAMSIZ - 1);
+	if (ioctl(sock, SIOCSIFNAME, &ifr)) {
+		fprintf(stderr, "rename %s to %s: %s\n", from, to,
+			strerror(errno));
+		return -1;
+	}
+	return 0;
+}
+
+/* The renamed device must show up in sysfs with its own ifindex. */
+static int check_dev(const char *dev)
+{
+	unsigned int ifindex = if_nametoindex(dev);
+	char buf[64];
+
+	if (!read_attr(dev, "ifindex", buf, sizeof(buf))) {
+		fprintf(stderr, "%s: no ifindex attribute after rename\n", dev);
+		return -1;
+	}
+	if (strtoul(buf, NULL, 10) != ifindex) {
+		fprintf(stderr, "%s: sysfs ifindex %s, expected %u\n",
+			dev, buf, ifindex);
+		return -1;
+	}
+	return 0;
+}
+
+static void del_devs(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < NR_NAMES; i++)
+		run("ip link del %s 2>/dev/null", names[i]);
+}
+
+int main(void)
+{
+	pthread_t threads[NR_READERS];
+	unsigned long total = 0;
+	int round, i, sock;
+
+	if (getuid()) {
+		printf("kernfs_stress: not root [SKIP]\n");
+		return 0;
+	}
+	del_devs();
+	if (run("ip link add %s type dummy 2>/dev/null", names[0])) {
+		printf("kernfs_stress: cannot create dummy devices [SKIP]\n");
+		return 0;
+	}
+	run("ip link del %s", names[0]);
+
+	sock = socket(AF_INET, SOCK_DGRAM, 0);
+	if (sock < 0) {
+		perror("socket");
+		return 1;
+	}
+
+	for (i = 0; i < NR_READERS; i++)
+		pthread_create(&threads[i], NULL, reader, &nr_reads[i]);
+
+	for (round = 0; round < NR_ROUNDS && !failed; round++) {
+		for (i = 0; i < NR_DEVS; i++)
+			if (run("ip link add %s type dummy", names[i])) {
+				failed = 1;
+				break;
+			}
+		for (i = 0; i < NR_DEVS && !failed; i++)
+			if (rename_dev(sock, names[i], names[i + NR_DEVS]) ||
+			    check_dev(names[i + NR_DEVS]))
+				failed = 1;
+		for (i = 0; i < NR_DEVS && !failed; i++)
+			if (rename_dev(sock, names[i + NR_DEVS], names[i]) ||
+			    check_dev(names[i]))
+				failed = 1;
+		del_devs();
+	}
+
+	stop = 1;
+	for (i = 0; i < NR_READERS; i++) {
+		pthread_join(threads[i], NULL);
+		total += nr_reads[i];
+	}
+	close(sock);
+	del_devs();
+
+	printf("kernfs_stress: %d rounds, %lu attribute reads\n", round, total);
+	if (failed) {
+		printf("kernfs_stress: [FAIL]\n");
+		return 1;
+	}
+	printf("kernfs_stress: [PASS]\n");
+	return 0;
+}